@@ -3,6 +3,7 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "threads/lock.h"
 #include "threads/malloc.h"
 
 /* A block device. */
@@ -27,7 +28,19 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 /* The block block assigned to each Pintos role. */
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
+/* Function to call to detect block devices before the first
+   lookup, or a null pointer. */
+static void (*pending_probe) (void);
+
+/* True if block_set_probe() was ever called.  PROBE_LOCK is
+   initialized then, and serializes running the probe, so that a
+   lookup made while another thread is probing waits until every
+   device has been registered. */
+static bool probe_set;
+static struct lock probe_lock;
+
 static struct block *list_elem_to_block (struct list_elem *);
+static void run_pending_probe (void);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -70,6 +83,7 @@ block_set_role (enum block_type role, struct block *block)
 struct block *
 block_first (void)
 {
+  run_pending_probe ();
   return list_elem_to_block (list_begin (&all_blocks));
 }
 
@@ -88,6 +102,7 @@ block_get_by_name (const char *name)
 {
   struct list_elem *e;
 
+  run_pending_probe ();
   for (e = list_begin (&all_blocks); e != list_end (&all_blocks);
        e = list_next (e))
     {
@@ -221,3 +236,35 @@ list_elem_to_block (struct list_elem *list_elem)
           : NULL);
 }
 
+/* Arranges for PROBE to be called, once, the first time that
+   block_first() or block_get_by_name() looks for a block device.
+   PROBE should detect block devices and register them with
+   block_register().  This lets a driver put off slow hardware
+   probing until some block device is actually needed. */
+void
+block_set_probe (void (*probe) (void))
+{
+  ASSERT (!probe_set);
+  lock_init (&probe_lock);
+  pending_probe = probe;
+  probe_set = true;
+}
+
+/* Calls the function passed to block_set_probe(), if it has not
+   been called yet, and returns once it has finished, even if
+   another thread is the one calling it. */
+static void
+run_pending_probe (void)
+{
+  void (*probe) (void);
+
+  if (!probe_set)
+    return;
+
+  lock_acquire (&probe_lock);
+  probe = pending_probe;
+  pending_probe = NULL;
+  if (probe != NULL)
+    probe ();
+  lock_release (&probe_lock);
+}
@@ -50,6 +50,10 @@
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
 
+/* Interrupt priority, if interrupts nest.  Above the serial
+   port's, below the timer's. */
+#define IDE_INTR_PRIORITY 8
+
 /* An ATA device. */
 struct ata_disk
   {
@@ -81,7 +85,7 @@ static struct channel channels[CHANNEL_CNT];
 
 static struct block_operations ide_operations;
 
-static void reset_channel (struct channel *);
+static bool reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
@@ -96,8 +100,12 @@ static void select_device (const struct ata_disk *);
 static void select_device_wait (const struct ata_disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static void ide_probe (void);
 
-/* Initialize the disk subsystem and detect disks. */
+/* Initialize the disk subsystem.  Disks are detected the first
+   time the block layer is asked for a block device, because
+   resetting a channel takes at least 150 ms, which boots that
+   never touch a disk should not pay. */
 void
 ide_init (void) 
 {
@@ -140,9 +148,27 @@ ide_init (void)
 
       /* Register interrupt handler. */
       intr_register_ext (c->irq, interrupt_handler, c->name);
+      intr_set_priority (c->irq, IDE_INTR_PRIORITY);
+    }
+
+  block_set_probe (ide_probe);
+}
 
-      /* Reset hardware. */
-      reset_channel (c);
+/* Detects the disks on each channel and registers them with the
+   block layer. */
+static void
+ide_probe (void)
+{
+  size_t chan_no;
+
+  for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
+    {
+      struct channel *c = &channels[chan_no];
+      int dev_no;
+
+      /* Reset hardware, unless there is nothing to reset. */
+      if (!reset_channel (c))
+        continue;
 
       /* Distinguish ATA hard disks from other devices. */
       if (check_device_type (&c->devices[0]))
@@ -160,8 +186,9 @@ ide_init (void)
 static char *descramble_ata_string (char *, int size);
 
 /* Resets an ATA channel and waits for any devices present on it
-   to finish the reset. */
-static void
+   to finish the reset.  Returns false, without resetting the
+   channel, if no devices are present on it. */
+static bool
 reset_channel (struct channel *c) 
 {
   bool present[2];
@@ -187,6 +214,8 @@ reset_channel (struct channel *c)
       present[dev_no] = (inb (reg_nsect (c)) == 0x55
                          && inb (reg_lbal (c)) == 0xaa);
     }
+  if (!present[0] && !present[1])
+    return false;
 
   /* Issue soft reset sequence, which selects device 0 as a side effect.
      Also enable interrupts. */
@@ -219,6 +248,7 @@ reset_channel (struct channel *c)
         }
       wait_while_busy (&c->devices[1]);
     }
+  return true;
 }
 
 /* Checks whether device D is an ATA disk and sets D's is_ata
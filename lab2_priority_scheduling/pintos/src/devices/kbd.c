@@ -1,12 +1,15 @@
 #include "devices/kbd.h"
 #include <ctype.h>
 #include <debug.h>
+#include <inttypes.h>
+#include <stats.h>
 #include <stdio.h>
 #include <string.h>
 #include "devices/input.h"
 #include "devices/shutdown.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/thread.h"
 
 /* Keyboard data register port. */
 #define DATA_REG 0x60
@@ -21,8 +24,13 @@ static bool left_ctrl, right_ctrl;      /* Left and right Ctl keys. */
    True when on, false when off. */
 static bool caps_lock;
 
+/* Priority of the keyboard's interrupt thread, if threaded
+   interrupt handlers are enabled.  Typing can wait for any
+   thread of default priority. */
+#define KBD_PRIORITY (PRI_DEFAULT - 1)
+
 /* Number of keys pressed. */
-static int64_t key_cnt;
+STAT_COUNTER (key_cnt, "kbd.keys");
 
 static intr_handler_func keyboard_interrupt;
 
@@ -30,14 +38,15 @@ static intr_handler_func keyboard_interrupt;
 void
 kbd_init (void) 
 {
-  intr_register_ext (0x21, keyboard_interrupt, "8042 Keyboard");
+  intr_register_threaded (0x21, KBD_PRIORITY, keyboard_interrupt,
+                          "8042 Keyboard");
 }
 
 /* Prints keyboard statistics. */
 void
 kbd_print_stats (void) 
 {
-  printf ("Keyboard: %lld keys pressed\n", key_cnt);
+  printf ("Keyboard: %"PRIu64" keys pressed\n", stat_value (&key_cnt));
 }
 
 /* Maps a set of contiguous scancodes into characters. */
@@ -156,7 +165,7 @@ keyboard_interrupt (struct intr_frame *args UNUSED)
           /* Append to keyboard buffer. */
           if (!input_full ())
             {
-              key_cnt++;
+              stat_inc (&key_cnt);
               input_putc (c);
             }
         }
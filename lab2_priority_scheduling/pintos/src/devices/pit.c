@@ -81,3 +81,42 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Busy-waits for USECS microseconds, which must be at most
+   54,925, the longest interval the PIT's 16-bit counter can
+   time, using channel 2 in mode 0 ("interrupt on terminal
+   count").  Channel 2's output is read back through port 0x61
+   rather than raising an interrupt, so this works with
+   interrupts off, before the timer is calibrated, for example to
+   calibrate another timer.  The speaker is disconnected from
+   channel 2 and left that way, so don't use this while playing a
+   tone. */
+void
+pit_busy_wait (unsigned usecs)
+{
+  uint32_t count = (uint64_t) usecs * PIT_HZ / 1000000;
+  enum intr_level old_level;
+  uint8_t gate;
+
+  ASSERT (count > 0 && count <= 0xffff);
+
+  old_level = intr_disable ();
+
+  /* Disconnect the speaker and drop channel 2's gate, which
+     holds the count until the gate rises again. */
+  gate = inb (0x61) & ~0x03;
+  outb (0x61, gate);
+
+  outb (PIT_PORT_CONTROL, (2 << 6) | 0x30 | (0 << 1));
+  outb (PIT_PORT_COUNTER (2), count);
+  outb (PIT_PORT_COUNTER (2), count >> 8);
+
+  /* Raise the gate to start counting, then wait for the output,
+     bit 5 of port 0x61, to go high at terminal count. */
+  outb (0x61, gate | 0x01);
+  while ((inb (0x61) & 0x20) == 0)
+    continue;
+
+  outb (0x61, gate);
+  intr_set_level (old_level);
+}
@@ -0,0 +1,211 @@
+#include "devices/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/rtc.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/tsc.h"
+#include "threads/vaddr.h"
+
+/* Sampling profiler.
+
+   When enabled with the "-profile" kernel option, the RTC's
+   periodic interrupt fires PROFILE_DEFAULT_HZ times per second,
+   independently of the 8254 timer that drives scheduling.  Each
+   interrupt records the interrupted instruction pointer plus a
+   short backtrace, obtained by following the saved frame
+   pointers from the interrupted %ebp, into a ring buffer.
+
+   At shutdown, identical stacks are merged and each distinct
+   stack is printed once with its sample count, as raw
+   addresses.  The host-side utils/pintos-profile script
+   resolves the addresses with utils/backtrace and prints a
+   per-function histogram or folded stacks for flame graph
+   tools.
+
+   The profiler also times its own interrupt handler and reports
+   the total as a fraction of the time it was running, so that
+   its overhead can be checked.  That leaves out the cost of
+   entering and leaving the interrupt, which the "trap"
+   benchmark measures. */
+
+/* Number of return addresses recorded per sample, beyond the
+   interrupted instruction pointer itself. */
+#define PROFILE_DEPTH 7
+
+/* Pages of memory devoted to the sample ring buffer. */
+#define PROFILE_PAGES 32
+
+/* One sample: the interrupted instruction followed by return
+   addresses of its callers, innermost first, padded with nulls. */
+struct sample
+  {
+    void *pc[PROFILE_DEPTH + 1];
+  };
+
+static unsigned profile_hz;             /* Sampling rate, 0 if off. */
+static struct sample *samples;          /* Ring buffer. */
+static size_t sample_cap;               /* Capacity of ring buffer. */
+static uint64_t sample_cnt;             /* Samples taken so far. */
+static uint64_t start_tsc;              /* TSC when sampling began. */
+static uint64_t handler_cycles;         /* Cycles spent sampling. */
+
+static intr_handler_func profile_interrupt;
+static int compare_samples (const void *, const void *);
+
+/* Enables sampling at HZ samples per second once profile_init()
+   is called.  HZ must be a power of 2 between 2 and 8192.
+   Called by the kernel command-line option parser. */
+void
+profile_configure (unsigned hz)
+{
+  if (hz < 2 || hz > 8192 || (hz & (hz - 1)) != 0)
+    PANIC ("profile rate %u is not a power of 2 between 2 and 8192", hz);
+  profile_hz = hz;
+}
+
+/* Allocates the sample buffer and starts sampling, if the
+   profiler was enabled by profile_configure().  Must be called
+   after the page allocator and interrupts are initialized. */
+void
+profile_init (void)
+{
+  if (profile_hz == 0)
+    return;
+
+  samples = palloc_get_multiple (PAL_ASSERT, PROFILE_PAGES);
+  sample_cap = PROFILE_PAGES * PGSIZE / sizeof *samples;
+
+  intr_register_ext (0x28, profile_interrupt, "RTC Profiler");
+  start_tsc = tsc_read ();
+  rtc_periodic_start (profile_hz);
+}
+
+/* Returns true if the profiler is enabled. */
+bool
+profile_enabled (void)
+{
+  return profile_hz != 0;
+}
+
+/* Prints the samples in the ring buffer, merging identical
+   stacks, one line per stack:
+
+     Profile: COUNT PC CALLER...
+
+   where PC is the interrupted instruction and the CALLERs are
+   return addresses, innermost first.  Before them, prints the
+   time spent in the interrupt handler. */
+void
+profile_print_stats (void)
+{
+  size_t cnt, i, distinct;
+  enum intr_level old_level;
+  uint64_t elapsed;
+
+  if (profile_hz == 0)
+    return;
+
+  /* Stop sampling while we sort the buffer in place. */
+  old_level = intr_disable ();
+  elapsed = tsc_read () - start_tsc;
+  cnt = sample_cnt < sample_cap ? sample_cnt : sample_cap;
+  qsort (samples, cnt, sizeof *samples, compare_samples);
+
+  distinct = 0;
+  for (i = 0; i < cnt; i++)
+    if (i == 0 || compare_samples (&samples[i - 1], &samples[i]))
+      distinct++;
+
+  printf ("Profile: %"PRIu64" samples at %u Hz, %zu retained, "
+          "%zu distinct stacks\n", sample_cnt, profile_hz, cnt, distinct);
+  if (elapsed > 0)
+    {
+      /* Hundredths of a percent. */
+      uint64_t bp = handler_cycles * 10000 / elapsed;
+
+      printf ("Profile: handler took %"PRIu64" of %"PRIu64" cycles "
+              "(%"PRIu64".%02"PRIu64"%%), %"PRIu64" cycles per sample\n",
+              handler_cycles, elapsed, bp / 100, bp % 100,
+              sample_cnt > 0 ? handler_cycles / sample_cnt : 0);
+    }
+  for (i = 0; i < cnt; )
+    {
+      size_t run, d;
+
+      for (run = 1; i + run < cnt; run++)
+        if (compare_samples (&samples[i], &samples[i + run]))
+          break;
+
+      printf ("Profile: %zu", run);
+      for (d = 0; d <= PROFILE_DEPTH && samples[i].pc[d] != NULL; d++)
+        printf (" %p", samples[i].pc[d]);
+      printf ("\n");
+      i += run;
+    }
+  intr_set_level (old_level);
+}
+
+/* RTC periodic interrupt handler.  Records the interrupted
+   instruction and its callers in the next ring buffer slot. */
+static void
+profile_interrupt (struct intr_frame *f)
+{
+  uint64_t start = tsc_read ();
+  struct sample *s = &samples[sample_cnt++ % sample_cap];
+  uintptr_t stack_lo, stack_hi;
+  void **frame;
+  size_t d;
+
+  rtc_periodic_ack ();
+
+  /* Interrupts are taken on the interrupted thread's kernel
+     stack, so F lies in the same page as every frame worth
+     following.  Any frame pointer outside it is garbage. */
+  stack_lo = (uintptr_t) pg_round_down (f);
+  stack_hi = stack_lo + PGSIZE;
+
+  s->pc[0] = (void *) f->eip;
+  frame = (void **) f->ebp;
+  for (d = 1; d <= PROFILE_DEPTH; d++)
+    {
+      void **next;
+
+      if ((uintptr_t) frame < stack_lo
+          || (uintptr_t) (frame + 2) > stack_hi
+          || frame[1] == NULL)
+        break;
+      s->pc[d] = frame[1];
+
+      /* Frames must move toward the top of the stack. */
+      next = frame[0];
+      if (next <= frame)
+        {
+          d++;
+          break;
+        }
+      frame = next;
+    }
+  for (; d <= PROFILE_DEPTH; d++)
+    s->pc[d] = NULL;
+
+  handler_cycles += tsc_read () - start;
+}
+
+/* qsort() comparison function for samples. */
+static int
+compare_samples (const void *a_, const void *b_)
+{
+  const struct sample *a = a_;
+  const struct sample *b = b_;
+  size_t d;
+
+  for (d = 0; d <= PROFILE_DEPTH; d++)
+    if (a->pc[d] != b->pc[d])
+      return (uintptr_t) a->pc[d] < (uintptr_t) b->pc[d] ? -1 : 1;
+  return 0;
+}
@@ -0,0 +1,14 @@
+#ifndef DEVICES_PROFILE_H
+#define DEVICES_PROFILE_H
+
+#include <stdbool.h>
+
+/* Default sampling rate, in samples per second. */
+#define PROFILE_DEFAULT_HZ 1024
+
+void profile_configure (unsigned hz);
+void profile_init (void);
+bool profile_enabled (void);
+void profile_print_stats (void);
+
+#endif /* devices/profile.h */
@@ -1,4 +1,5 @@
 #include "devices/rtc.h"
+#include <debug.h>
 #include <stdio.h>
 #include "threads/io.h"
 
@@ -28,14 +29,17 @@
 
 /* Register A. */
 #define RTCSA_UIP	0x80	/* Set while time update in progress. */
+#define RTCSA_RATE	0x0f	/* Periodic interrupt rate selector. */
 
 /* Register B. */
 #define	RTCSB_SET	0x80	/* Disables update to let time be set. */
+#define RTCSB_PIE	0x40	/* Enables periodic interrupt. */
 #define RTCSB_DM	0x04	/* 0 = BCD time format, 1 = binary format. */
 #define RTCSB_24HR	0x02    /* 0 = 12-hour format, 1 = 24-hour format. */
 
 static int bcd_to_bin (uint8_t);
 static uint8_t cmos_read (uint8_t index);
+static void cmos_write (uint8_t index, uint8_t data);
 
 /* Returns number of seconds since Unix epoch of January 1,
    1970. */
@@ -95,6 +99,34 @@ rtc_get_time (void)
   return time;
 }
 
+/* Starts the RTC raising IRQ 8 (interrupt 0x28) HZ times per
+   second.  HZ must be a power of 2 between 2 and 8192.  The
+   interrupt handler must call rtc_periodic_ack() on every
+   interrupt, or the RTC will not raise another one. */
+void
+rtc_periodic_start (unsigned hz)
+{
+  uint8_t rate;
+
+  ASSERT (hz >= 2 && hz <= 8192 && (hz & (hz - 1)) == 0);
+
+  /* The periodic rate is 32768 >> (RATE - 1) Hz. */
+  for (rate = 1; (32768u >> (rate - 1)) != hz; rate++)
+    continue;
+
+  cmos_write (RTC_REG_A, (cmos_read (RTC_REG_A) & ~RTCSA_RATE) | rate);
+  cmos_write (RTC_REG_B, cmos_read (RTC_REG_B) | RTCSB_PIE);
+  rtc_periodic_ack ();
+}
+
+/* Acknowledges a periodic interrupt by reading register C, which
+   clears the RTC's pending interrupt flags. */
+void
+rtc_periodic_ack (void)
+{
+  cmos_read (RTC_REG_C);
+}
+
 /* Returns the integer value of the given BCD byte. */
 static int
 bcd_to_bin (uint8_t x)
@@ -110,3 +142,11 @@ cmos_read (uint8_t index)
   outb (CMOS_REG_SET, index);
   return inb (CMOS_REG_IO);
 }
+
+/* Writes DATA to the CMOS register with the given INDEX. */
+static void
+cmos_write (uint8_t index, uint8_t data)
+{
+  outb (CMOS_REG_SET, index);
+  outb (CMOS_REG_IO, data);
+}
@@ -4,5 +4,7 @@
 typedef unsigned long time_t;
 
 time_t rtc_get_time (void);
+void rtc_periodic_start (unsigned hz);
+void rtc_periodic_ack (void);
 
 #endif
@@ -6,6 +6,7 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/spinlock.h"
 #include "threads/thread.h"
 
 
@@ -48,6 +49,15 @@
 /* Line Status Register. */
 #define LSR_DR 0x01             /* Data Ready: received data byte is in RBR. */
 #define LSR_THRE 0x20           /* THR Empty. */
+
+/* Interrupt priority, if interrupts nest.  A burst of received
+   bytes shouldn't hold up the timer. */
+#define SERIAL_INTR_PRIORITY 4
+
+/* Priority of the serial port's interrupt thread, if threaded
+   interrupt handlers are enabled.  It must be able to preempt
+   any thread that prints, or the transmit queue never drains. */
+#define SERIAL_THREAD_PRIORITY PRI_MAX
 
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
@@ -55,6 +65,14 @@ static enum { UNINIT, POLL, QUEUE } mode;
 /* Data to be transmitted. */
 static struct intq txq;
 
+/* Serializes access to TXQ and the UART's transmit side between
+   CPUs.  Turning interrupts off is enough with only one CPU. */
+static struct spinlock tx_lock;
+
+/* True once a kernel panic is underway.  From then on output
+   bypasses TX_LOCK, which the panicking CPU might hold. */
+static bool panicking;
+
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
 static void write_ier (void);
@@ -88,7 +106,9 @@ serial_init_queue (void)
     init_poll ();
   ASSERT (mode == POLL);
 
-  intr_register_ext (0x20 + 4, serial_interrupt, "serial");
+  intr_register_threaded (0x20 + 4, SERIAL_THREAD_PRIORITY, serial_interrupt,
+                          "serial");
+  intr_set_priority (0x20 + 4, SERIAL_INTR_PRIORITY);
   mode = QUEUE;
   old_level = intr_disable ();
   write_ier ();
@@ -101,6 +121,20 @@ serial_putc (uint8_t byte)
 {
   enum intr_level old_level = intr_disable ();
 
+  if (panicking)
+    {
+      /* Get the panic message out by polling, after whatever
+         is still queued. */
+      if (mode == UNINIT)
+        init_poll ();
+      while (!intq_empty (&txq))
+        putc_poll (intq_getc (&txq));
+      putc_poll (byte);
+      intr_set_level (old_level);
+      return;
+    }
+
+  spinlock_acquire (&tx_lock);
   if (mode != QUEUE)
     {
       /* If we're not set up for interrupt-driven I/O yet,
@@ -113,19 +147,20 @@ serial_putc (uint8_t byte)
     {
       /* Otherwise, queue a byte and update the interrupt enable
          register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      if (intq_full (&txq)) 
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
+          /* The transmit queue is full.  If we wanted to wait
+             for the queue to empty, we'd have to sleep holding
+             tx_lock, and the serial interrupt that drains the
+             queue needs tx_lock itself.  So we send a character
+             via polling instead. */
           putc_poll (intq_getc (&txq)); 
         }
 
       intq_putc (&txq, byte); 
       write_ier ();
     }
+  spinlock_release (&tx_lock);
   
   intr_set_level (old_level);
 }
@@ -136,11 +171,24 @@ void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
+  if (!panicking)
+    spinlock_acquire (&tx_lock);
   while (!intq_empty (&txq))
     putc_poll (intq_getc (&txq));
+  if (!panicking)
+    spinlock_release (&tx_lock);
   intr_set_level (old_level);
 }
 
+/* Notifies the serial driver that a kernel panic is underway.
+   From now on, output is sent by polling without taking any
+   locks. */
+void
+serial_panic (void) 
+{
+  panicking = true;
+}
+
 /* The fullness of the input buffer may have changed.  Reassess
    whether we should block receive interrupts.
    Called by the input buffer routines when characters are added
@@ -150,7 +198,11 @@ serial_notify (void)
 {
   ASSERT (intr_get_level () == INTR_OFF);
   if (mode == QUEUE)
-    write_ier ();
+    {
+      spinlock_acquire (&tx_lock);
+      write_ier ();
+      spinlock_release (&tx_lock);
+    }
 }
 
 /* Configures the serial port for BPS bits per second. */
@@ -206,24 +258,41 @@ putc_poll (uint8_t byte)
   outb (THR_REG, byte);
 }
 
-/* Serial interrupt handler. */
+/* Serial interrupt handler.  May run with interrupts on, if
+   interrupts nest, so it turns them off itself as needed. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) 
 {
+  enum intr_level old_level;
+  bool received;
+
   /* Inquire about interrupt in UART.  Without this, we can
      occasionally miss an interrupt running under QEMU. */
   inb (IIR_REG);
 
   /* As long as we have room to receive a byte, and the hardware
-     has a byte for us, receive a byte.  */
-  while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
-    input_putc (inb (RBR_REG));
+     has a byte for us, receive a byte.  Interrupts are turned
+     back on between bytes, so that a burst doesn't delay more
+     important interrupts.  */
+  do
+    {
+      old_level = intr_disable ();
+      received = !input_full () && (inb (LSR_REG) & LSR_DR) != 0;
+      if (received)
+        input_putc (inb (RBR_REG));
+      intr_set_level (old_level);
+    }
+  while (received);
 
   /* As long as we have a byte to transmit, and the hardware is
      ready to accept a byte for transmission, transmit a byte. */
+  old_level = intr_disable ();
+  spinlock_acquire (&tx_lock);
   while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
     outb (THR_REG, intq_getc (&txq));
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
+  spinlock_release (&tx_lock);
+  intr_set_level (old_level);
 }
@@ -7,5 +7,6 @@ void serial_init_queue (void);
 void serial_putc (uint8_t);
 void serial_flush (void);
 void serial_notify (void);
+void serial_panic (void);
 
 #endif /* devices/serial.h */
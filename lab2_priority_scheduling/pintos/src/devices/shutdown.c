@@ -1,11 +1,16 @@
 #include "devices/shutdown.h"
 #include <console.h>
+#include <stats.h>
 #include <stdio.h>
 #include "devices/kbd.h"
+#include "devices/profile.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
@@ -124,12 +129,17 @@ static void
 print_stats (void)
 {
   timer_print_stats ();
+  intr_print_stats ();
   thread_print_stats ();
+  cpu_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
   console_print_stats ();
   kbd_print_stats ();
+  profile_print_stats ();
+  trace_print_stats ();
+  stats_print ();
 #ifdef USERPROG
   exception_print_stats ();
 #endif
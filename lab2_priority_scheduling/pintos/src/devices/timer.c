@@ -1,13 +1,21 @@
+#include <clock-page.h>
 #include <debug.h>
 #include <inttypes.h>
 #include <round.h>
+#include <stats.h>
 #include <stdio.h>
 
 #include "devices/pit.h"
 #include "devices/timer.h"
+#include "threads/apic.h"
 #include "threads/barrier.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/spinlock.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/tsc.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -18,10 +26,22 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-// Number of timer ticks since OS booted.
-static int64_t ticks;
+// Number of timer ticks since OS booted, counted by the boot
+// processor.  Other CPUs may read it at any time, so it is read
+// through the clock page with timer_ticks().
+static volatile int64_t ticks;
 
-// Number of loops per timer tick.  Initialized by timer_calibrate().
+// Time-stamp counter value at the start of the latest timer tick.
+static uint64_t last_tick_tsc;
+
+// Clock page, published on every tick (see lib/clock-page.h), and
+// the tick and TSC it measures tsc_per_tick from.
+static struct clock_page *clock_page;
+static int64_t base_ticks;
+static uint64_t base_tsc;
+
+// Number of loops per timer tick.  Initialized by timer_calibrate(),
+// unless already set by timer_set_loops_per_tick().
 static unsigned loops_per_tick;
 
 static bool too_many_loops(unsigned loops);
@@ -30,23 +50,53 @@ extern char *rguid;
 static intr_handler_func timer_interrupt;
 static void real_time_delay(int64_t num, int32_t denom);
 static void real_time_sleep(int64_t num, int32_t denom);
+static void publish_tick(uint64_t tsc);
 /*@a*/
-struct list sleeping_list; // Needs to be initialized still
+struct clist sleeping_list; // Counted, so its length is O(1)
+static struct spinlock sleeping_lock; // Protects sleeping_list
 static bool sleeping_lt(struct list_elem *a, struct list_elem *b);
 /*@e*/
 
+static int64_t sleeping_gauge(void);
+STAT_GAUGE_FUNC(ticks_stat, "timer.ticks", timer_ticks);
+STAT_GAUGE_FUNC(sleeping_stat, "timer.sleeping", sleeping_gauge);
+STAT_COUNTER(wake_stat, "timer.wakeups");
+
 /*
  * Sets up the timer to interrupt TIMER_FREQ times per second,
  * and registers the corresponding interrupt.
  */
 void timer_init(void) {
-  pit_configure_channel((int)(rguid = 0), 2, TIMER_FREQ);
-  intr_register_ext(0x20, timer_interrupt, "8254 Timer");
+  if (apic_timer_start(TIMER_FREQ, 0x20)) {
+    intr_register_ext(0x20, timer_interrupt, "LAPIC Timer");
+  } else {
+    pit_configure_channel((int)(rguid = 0), 2, TIMER_FREQ);
+    intr_register_ext(0x20, timer_interrupt, "8254 Timer");
+  }
   /*@a*/
-  list_init(&sleeping_list);
+  clist_init(&sleeping_list);
+  spinlock_init(&sleeping_lock);
   /*@e*/
+
+  clock_page = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+  clock_page->timer_freq = TIMER_FREQ;
 }
 
+/*
+ * Starts the timer on an application processor, which has its own
+ * local APIC timer.  Only the boot processor's timer counts ticks
+ * and wakes sleeping threads; the others just drive their CPU's
+ * time slices.
+ */
+void timer_init_ap(void) { apic_timer_start(TIMER_FREQ, 0x20); }
+
+/*
+ * Sets loops_per_tick to LOOPS, the value a previous boot's
+ * timer_calibrate() found on the same machine, so that
+ * timer_calibrate() can skip calibration.
+ */
+void timer_set_loops_per_tick(unsigned loops) { loops_per_tick = loops; }
+
 /*
  * Calibrates loops_per_tick, used to implement brief delays.
  */
@@ -55,6 +105,11 @@ void timer_calibrate(void) {
 
   ASSERT(intr_get_level() == INTR_ON);
   printf("Calibrating timer...  ");
+  if (loops_per_tick != 0) {
+    printf("skipped, %'" PRIu64 " loops/s (%u loops/tick).\n",
+           (uint64_t)loops_per_tick * TIMER_FREQ, loops_per_tick);
+    return;
+  }
 
   /* Approximate loops_per_tick as the largest power-of-two
    still less than one timer tick. */
@@ -70,17 +125,20 @@ void timer_calibrate(void) {
     if (!too_many_loops(high_bit | test_bit))
       loops_per_tick |= test_bit;
 
-  printf("%'" PRIu64 " loops/s.\n", (uint64_t)loops_per_tick * TIMER_FREQ);
+  printf("%'" PRIu64 " loops/s (%u loops/tick).\n",
+         (uint64_t)loops_per_tick * TIMER_FREQ, loops_per_tick);
 }
 
 /*
  * Returns the number of timer ticks since the OS booted.
  */
 int64_t timer_ticks(void) {
-  enum intr_level old_level = intr_disable();
-  int64_t t = ticks;
-  intr_set_level(old_level);
-  return t;
+  struct clock_page c;
+
+  if (clock_page == NULL)
+    return ticks;
+  clock_page_read(clock_page, &c);
+  return c.ticks;
 }
 
 /*
@@ -89,6 +147,55 @@ int64_t timer_ticks(void) {
  */
 int64_t timer_elapsed(int64_t then) { return timer_ticks() - then; }
 
+/*
+ * Returns the time-stamp counter value read at the start of the
+ * most recent timer interrupt, for measuring how long after a
+ * tick something happens.
+ */
+uint64_t timer_last_tick_tsc(void) {
+  struct clock_page c;
+
+  if (clock_page == NULL)
+    return last_tick_tsc;
+  clock_page_read(clock_page, &c);
+  return c.tick_tsc;
+}
+
+/*
+ * Returns the nanoseconds since the OS booted, interpolated
+ * between timer ticks with the time-stamp counter.  Never locks
+ * anything, so it may be called from anywhere.
+ */
+uint64_t timer_now_ns(void) {
+  ASSERT(clock_page != NULL);
+  return clock_page_ns(clock_page, tsc_read());
+}
+
+/*
+ * Returns the clock page, for mapping read-only into user
+ * processes.
+ */
+const struct clock_page *timer_clock_page(void) { return clock_page; }
+
+/* Publishes the tick that just began at time-stamp counter TSC
+   on the clock page.  Only the boot processor's timer interrupt
+   writes the clock page, so writers need no lock of their own. */
+static void publish_tick(uint64_t tsc) {
+  if (ticks == 1) {
+    base_ticks = ticks;
+    base_tsc = tsc;
+  }
+
+  clock_page->seq++;
+  barrier();
+  clock_page->ticks = ticks;
+  clock_page->tick_tsc = tsc;
+  if (ticks > base_ticks)
+    clock_page->tsc_per_tick = (tsc - base_tsc) / (ticks - base_ticks);
+  barrier();
+  clock_page->seq++;
+}
+
 /*
  * Sleeps for approximately TICKS timer ticks.
  * Interrupts must be turned on.
@@ -103,8 +210,9 @@ void timer_sleep(int64_t ticks) {
   struct thread *t = thread_current();
   enum intr_level old_level = intr_disable();
   t->sleep_till = start + ticks;
-  list_insert_ordered(&sleeping_list, &t->sharedelem, sleeping_lt, NULL);
-  thread_block();
+  spinlock_acquire(&sleeping_lock);
+  clist_insert_ordered(&sleeping_list, &t->sharedelem, sleeping_lt, NULL);
+  thread_block_locked(&sleeping_lock);
   intr_set_level(old_level); // Preserve previous intr status
   /*@e*/
 }
@@ -167,25 +275,44 @@ void timer_print_stats(void) {
   printf("Timer: %" PRId64 " ticks\n", timer_ticks());
 }
 
+/*
+ * Returns the number of threads blocked in timer_sleep().
+ * Runs in O(1).
+ */
+size_t timer_sleeping_count(void) { return clist_size(&sleeping_list); }
+
+/* Reads the "timer.sleeping" statistic. */
+static int64_t sleeping_gauge(void) { return timer_sleeping_count(); }
+
 /*
  * Timer interrupt handler.
  */
 static void timer_interrupt(struct intr_frame *args UNUSED) {
+  if (cpu_current()->id != 0) {
+    thread_tick();
+    return;
+  }
+  last_tick_tsc = tsc_read();
   ticks++;
+  publish_tick(last_tick_tsc);
   thread_tick();
   /*@a*/
   // Check every thread to see if their sleep time has passed
   /* struct list_elem *t; */
-  while (!list_empty(&sleeping_list)) {
+  spinlock_acquire(&sleeping_lock);
+  while (!clist_empty(&sleeping_list)) {
     struct thread *t =
-        list_entry(list_front(&sleeping_list), struct thread, sharedelem);
+        list_entry(clist_front(&sleeping_list), struct thread, sharedelem);
     if (t->sleep_till <= timer_ticks()) {
-      list_pop_front(&sleeping_list);
+      clist_pop_front(&sleeping_list);
+      trace_event(TRACE_WAKE, 0, t->priority, t->tid, 0);
+      stat_inc(&wake_stat);
       thread_unblock(t);
     } else {
       break;
     }
   }
+  spinlock_release(&sleeping_lock);
   /*@e*/
 }
 
@@ -2,16 +2,24 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+struct clock_page;
+
 void timer_init (void);
+void timer_init_ap (void);
 void timer_calibrate (void);
+void timer_set_loops_per_tick (unsigned);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+uint64_t timer_last_tick_tsc (void);
+uint64_t timer_now_ns (void);
+const struct clock_page *timer_clock_page (void);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
@@ -25,5 +33,6 @@ void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
 void timer_print_stats (void);
+size_t timer_sleeping_count (void);
 
 #endif /* devices/timer.h */
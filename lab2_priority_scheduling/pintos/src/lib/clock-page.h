@@ -0,0 +1,78 @@
+#ifndef __LIB_CLOCK_PAGE_H
+#define __LIB_CLOCK_PAGE_H
+
+#include <stdint.h>
+
+/* Clock page.
+
+   The kernel keeps the time in a page of its own, which it
+   updates on every timer tick, so that the time can be read
+   without locking anything or entering the kernel.  The page is
+   meant to be mapped read-only into user processes as well.
+
+   The page is protected by a sequence lock: the kernel makes SEQ
+   odd while it updates the page and even again when it is done,
+   so a reader that sees the same even SEQ before and after
+   copying the page knows that it got a consistent copy.  Readers
+   never block the kernel; at worst they retry. */
+struct clock_page
+  {
+    volatile uint32_t seq;      /* Odd while being updated. */
+    uint32_t timer_freq;        /* Timer ticks per second. */
+    int64_t ticks;              /* Timer ticks since boot. */
+    uint64_t tick_tsc;          /* Time-stamp counter at last tick. */
+    uint64_t tsc_per_tick;      /* Measured TSC cycles per tick, or 0. */
+  };
+
+/* Optimization barrier, so that the compiler neither caches SEQ
+   nor moves reads of the other members across reads of it.  x86
+   does not reorder loads with other loads, so nothing more is
+   needed. */
+#define clock_page_barrier() asm volatile ("" : : : "memory")
+
+/* Copies *PAGE into *COPY, consistently. */
+static inline void
+clock_page_read (const struct clock_page *page, struct clock_page *copy)
+{
+  uint32_t seq;
+
+  do
+    {
+      while ((seq = page->seq) & 1)
+        continue;
+      clock_page_barrier ();
+      copy->timer_freq = page->timer_freq;
+      copy->ticks = page->ticks;
+      copy->tick_tsc = page->tick_tsc;
+      copy->tsc_per_tick = page->tsc_per_tick;
+      clock_page_barrier ();
+    }
+  while (page->seq != seq);
+  copy->seq = seq;
+}
+
+/* Returns the nanoseconds since boot according to PAGE, given
+   the current time-stamp counter value TSC.  Interpolates
+   between ticks with the TSC, if the TSC has been measured. */
+static inline uint64_t
+clock_page_ns (const struct clock_page *page, uint64_t tsc)
+{
+  struct clock_page c;
+  uint64_t ns;
+
+  clock_page_read (page, &c);
+  ns = (uint64_t) c.ticks * 1000000000 / c.timer_freq;
+  if (c.tsc_per_tick != 0 && tsc > c.tick_tsc)
+    {
+      uint64_t since = tsc - c.tick_tsc;
+
+      /* A reader that is slow to finish may be more than a tick
+         past TICK_TSC. */
+      if (since > c.tsc_per_tick)
+        since = c.tsc_per_tick;
+      ns += since * (1000000000 / c.timer_freq) / c.tsc_per_tick;
+    }
+  return ns;
+}
+
+#endif /* lib/clock-page.h */
@@ -1,5 +1,7 @@
 #include <console.h>
+#include <inttypes.h>
 #include <stdarg.h>
+#include <stats.h>
 #include <stdio.h>
 
 #include "devices/serial.h"
@@ -58,7 +60,7 @@ static bool use_console_lock;
 static int console_lock_depth;
 
 /* Number of characters written to console. */
-static int64_t write_cnt;
+STAT_COUNTER (write_cnt, "console.chars");
 
 /* Enable console locking. */
 void
@@ -75,13 +77,14 @@ void
 console_panic (void) 
 {
   use_console_lock = false;
+  serial_panic ();
 }
 
 /* Prints console statistics. */
 void
 console_print_stats (void) 
 {
-  printf ("Console: %lld characters output\n", write_cnt);
+  printf ("Console: %"PRIu64" characters output\n", stat_value (&write_cnt));
 }
 
 /* Acquires the console lock. */
@@ -186,7 +189,7 @@ static void
 putchar_have_lock (uint8_t c) 
 {
   ASSERT (console_locked_by_current_thread ());
-  write_cnt++;
+  stat_inc (&write_cnt);
   serial_putc (c);
   vga_putc (c);
 }
@@ -294,7 +294,8 @@ list_back (struct list *list)
 }
 
 /* Returns the number of elements in LIST.
-   Runs in O(n) in the number of elements. */
+   Runs in O(n) in the number of elements.  Use a struct clist
+   instead if the size is needed often. */
 size_t
 list_size (struct list *list)
 {
@@ -523,3 +524,155 @@ list_min (struct list *list, list_less_func *less, void *aux)
     }
   return min;
 }
+
+/* Initializes CLIST as an empty counted list. */
+void
+clist_init (struct clist *clist)
+{
+  ASSERT (clist != NULL);
+  list_init (&clist->list);
+  clist->size = 0;
+}
+
+/* Returns the plain list underlying CLIST.  The caller must not
+   use it to add or remove elements, or CLIST's count will go
+   stale. */
+struct list *
+clist_list (struct clist *clist)
+{
+  ASSERT (clist != NULL);
+  return &clist->list;
+}
+
+/* Returns the beginning of CLIST.  See list_begin(). */
+struct list_elem *
+clist_begin (struct clist *clist)
+{
+  return list_begin (&clist->list);
+}
+
+/* Returns CLIST's tail.  See list_end(). */
+struct list_elem *
+clist_end (struct clist *clist)
+{
+  return list_end (&clist->list);
+}
+
+/* Returns CLIST's reverse beginning.  See list_rbegin(). */
+struct list_elem *
+clist_rbegin (struct clist *clist)
+{
+  return list_rbegin (&clist->list);
+}
+
+/* Returns CLIST's head.  See list_rend(). */
+struct list_elem *
+clist_rend (struct clist *clist)
+{
+  return list_rend (&clist->list);
+}
+
+/* Inserts ELEM just before BEFORE, which must be an interior
+   element or the tail of CLIST. */
+void
+clist_insert (struct clist *clist, struct list_elem *before,
+              struct list_elem *elem)
+{
+  list_insert (before, elem);
+  clist->size++;
+}
+
+/* Inserts ELEM at the beginning of CLIST. */
+void
+clist_push_front (struct clist *clist, struct list_elem *elem)
+{
+  clist_insert (clist, clist_begin (clist), elem);
+}
+
+/* Inserts ELEM at the end of CLIST. */
+void
+clist_push_back (struct clist *clist, struct list_elem *elem)
+{
+  clist_insert (clist, clist_end (clist), elem);
+}
+
+/* Inserts ELEM in the proper position in CLIST, which must be
+   sorted according to LESS given auxiliary data AUX.  See
+   list_insert_ordered(). */
+void
+clist_insert_ordered (struct clist *clist, struct list_elem *elem,
+                      list_less_func *less, void *aux)
+{
+  list_insert_ordered (&clist->list, elem, less, aux);
+  clist->size++;
+}
+
+/* Removes ELEM, which must be an element of CLIST, and returns
+   the element that followed it.  See list_remove(). */
+struct list_elem *
+clist_remove (struct clist *clist, struct list_elem *elem)
+{
+  ASSERT (clist->size > 0);
+  clist->size--;
+  return list_remove (elem);
+}
+
+/* Removes the front element from CLIST and returns it.
+   Undefined behavior if CLIST is empty before removal. */
+struct list_elem *
+clist_pop_front (struct clist *clist)
+{
+  struct list_elem *front = clist_front (clist);
+  clist_remove (clist, front);
+  return front;
+}
+
+/* Removes the back element from CLIST and returns it.
+   Undefined behavior if CLIST is empty before removal. */
+struct list_elem *
+clist_pop_back (struct clist *clist)
+{
+  struct list_elem *back = clist_back (clist);
+  clist_remove (clist, back);
+  return back;
+}
+
+/* Returns the front element in CLIST.
+   Undefined behavior if CLIST is empty. */
+struct list_elem *
+clist_front (struct clist *clist)
+{
+  return list_front (&clist->list);
+}
+
+/* Returns the back element in CLIST.
+   Undefined behavior if CLIST is empty. */
+struct list_elem *
+clist_back (struct clist *clist)
+{
+  return list_back (&clist->list);
+}
+
+/* Returns the number of elements in CLIST.
+   Runs in O(1). */
+size_t
+clist_size (struct clist *clist)
+{
+  ASSERT (clist->size == 0 || !list_empty (&clist->list));
+  return clist->size;
+}
+
+/* Returns true if CLIST is empty, false otherwise. */
+bool
+clist_empty (struct clist *clist)
+{
+  return list_empty (&clist->list);
+}
+
+/* Sorts CLIST according to LESS given auxiliary data AUX.
+   Sorting does not change the number of elements. */
+void
+clist_sort (struct clist *clist, list_less_func *less, void *aux)
+{
+  list_sort (&clist->list, less, aux);
+}
@@ -178,4 +178,69 @@ void list_unique (struct list *, struct list *duplicates,
 struct list_elem *list_max (struct list *, list_less_func *, void *aux);
 struct list_elem *list_min (struct list *, list_less_func *, void *aux);
 
+/* Counted list.
+
+   A `struct clist' is a `struct list' that also keeps track of
+   how many elements it holds, so that clist_size() runs in O(1)
+   instead of walking the list.  The count is only correct as
+   long as every insertion and removal goes through the clist_*()
+   functions below; in particular, an element of a counted list
+   must be removed with clist_remove(), not list_remove().
+
+   Iteration is the same as for a plain list, since
+   clist_begin() and clist_end() return ordinary list elements:
+
+      struct list_elem *e;
+
+      for (e = clist_begin (&foo_clist); e != clist_end (&foo_clist);
+           e = list_next (e))
+        {
+          struct foo *f = list_entry (e, struct foo, elem);
+          ...do something with f...
+        }
+
+   Read-only list operations that are not duplicated here, such
+   as list_max(), may be applied to clist_list(). */
+struct clist
+  {
+    struct list list;           /* Underlying list. */
+    size_t size;                /* Number of elements in LIST. */
+  };
+
+/* Counted list initializer, analogous to LIST_INITIALIZER. */
+#define CLIST_INITIALIZER(NAME) { LIST_INITIALIZER ((NAME).list), 0 }
+
+void clist_init (struct clist *);
+struct list *clist_list (struct clist *);
+
+/* Counted list traversal. */
+struct list_elem *clist_begin (struct clist *);
+struct list_elem *clist_end (struct clist *);
+struct list_elem *clist_rbegin (struct clist *);
+struct list_elem *clist_rend (struct clist *);
+
+/* Counted list insertion. */
+void clist_insert (struct clist *, struct list_elem *before,
+                   struct list_elem *);
+void clist_push_front (struct clist *, struct list_elem *);
+void clist_push_back (struct clist *, struct list_elem *);
+void clist_insert_ordered (struct clist *, struct list_elem *,
+                           list_less_func *, void *aux);
+
+/* Counted list removal. */
+struct list_elem *clist_remove (struct clist *, struct list_elem *);
+struct list_elem *clist_pop_front (struct clist *);
+struct list_elem *clist_pop_back (struct clist *);
+
+/* Counted list elements. */
+struct list_elem *clist_front (struct clist *);
+struct list_elem *clist_back (struct clist *);
+
+/* Counted list properties. */
+size_t clist_size (struct clist *);
+bool clist_empty (struct clist *);
+
+/* Counted list ordering. */
+void clist_sort (struct clist *, list_less_func *, void *aux);
+
 #endif /* lib/kernel/list.h */
@@ -0,0 +1,595 @@
+/* Radix tree.
+
+   See radix.h for basic information. */
+
+#include "radix.h"
+#include "../debug.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Each node consumes RADIX_BITS bits of the key.  With 9 bits
+   per level a node holds 512 slots plus its tag bitmaps, which
+   fits in one page, and four levels cover a 32-bit key. */
+#define RADIX_BITS 9
+#define RADIX_SLOTS (1 << RADIX_BITS)
+#define RADIX_MASK (RADIX_SLOTS - 1)
+#define RADIX_MAX_HEIGHT ((32 + RADIX_BITS - 1) / RADIX_BITS)
+
+/* Number of 32-bit words in each of a node's tag bitmaps. */
+#define TAG_WORDS (RADIX_SLOTS / 32)
+
+/* Pseudo-tag that matches every item, for find_next(). */
+#define ANY_TAG (-1)
+
+/* Tree node.  At height 1 (the leaves) the slots point to
+   items, at greater heights to child nodes.  Bit I of
+   tags[TAG] is set if slot I holds an item tagged TAG or a
+   subtree containing at least one such item. */
+struct radix_node
+  {
+    unsigned count;                     /* Number of non-null slots. */
+    uint32_t tags[RADIX_TAG_CNT][TAG_WORDS]; /* Tag bitmaps. */
+    void *slots[RADIX_SLOTS];           /* Items or child nodes. */
+  };
+
+static bool extend (struct radix *, uint32_t key);
+static void shrink (struct radix *);
+static void **find_slot (const struct radix *, uint32_t key,
+                         struct radix_node **path);
+static void clear_tag_path (struct radix *, struct radix_node **path,
+                            uint32_t key, int tag);
+static void *find_next (const struct radix *, uint32_t start, int tag,
+                        uint32_t *keyp);
+static size_t gang_lookup (const struct radix *, uint32_t first,
+                           void **items, uint32_t *keys, size_t max,
+                           int tag);
+static void destroy_node (struct radix_node *, unsigned height,
+                          uint32_t base, radix_action_func *, void *aux);
+
+/* Returns the largest key that a tree of the given HEIGHT can
+   hold. */
+static inline uint32_t
+max_key (unsigned height)
+{
+  if (height * RADIX_BITS >= 32)
+    return UINT32_MAX;
+  return (1u << (height * RADIX_BITS)) - 1;
+}
+
+/* Returns the index of the slot for KEY in a node at HEIGHT. */
+static inline size_t
+slot_index (uint32_t key, unsigned height)
+{
+  return (key >> ((height - 1) * RADIX_BITS)) & RADIX_MASK;
+}
+
+/* Returns true if slot IDX in node N is tagged with TAG. */
+static inline bool
+tag_test (const struct radix_node *n, int tag, size_t idx)
+{
+  return (n->tags[tag][idx / 32] & (1u << (idx % 32))) != 0;
+}
+
+/* Tags slot IDX in node N with TAG. */
+static inline void
+tag_mark (struct radix_node *n, int tag, size_t idx)
+{
+  n->tags[tag][idx / 32] |= 1u << (idx % 32);
+}
+
+/* Removes tag TAG from slot IDX in node N. */
+static inline void
+tag_reset (struct radix_node *n, int tag, size_t idx)
+{
+  n->tags[tag][idx / 32] &= ~(1u << (idx % 32));
+}
+
+/* Returns true if any slot in node N is tagged with TAG. */
+static bool
+tag_any (const struct radix_node *n, int tag)
+{
+  size_t i;
+
+  for (i = 0; i < TAG_WORDS; i++)
+    if (n->tags[tag][i] != 0)
+      return true;
+  return false;
+}
+
+/* Allocates and returns a new, empty node, or a null pointer if
+   no memory is available. */
+static struct radix_node *
+node_alloc (void)
+{
+  return palloc_get_page (PAL_ZERO);
+}
+
+/* Frees node N. */
+static void
+node_free (struct radix_node *n)
+{
+  palloc_free_page (n);
+}
+
+/* Initializes R as an empty radix tree.  Does not allocate any
+   memory. */
+void
+radix_init (struct radix *r)
+{
+  ASSERT (r != NULL);
+  ASSERT (sizeof (struct radix_node) <= PGSIZE);
+
+  r->root = NULL;
+  r->height = 0;
+  r->item_cnt = 0;
+}
+
+/* Frees all of R's nodes, leaving it empty.
+
+   If DESTRUCTOR is non-null, then it is called for each item in
+   the tree, in key order, given auxiliary data AUX.  DESTRUCTOR
+   may deallocate the item, but it must not modify R. */
+void
+radix_destroy (struct radix *r, radix_action_func *destructor, void *aux)
+{
+  ASSERT (r != NULL);
+
+  if (r->root != NULL)
+    destroy_node (r->root, r->height, 0, destructor, aux);
+  radix_init (r);
+}
+
+/* Inserts ITEM, which must not be null, into R under KEY.
+   Returns true if successful, false if R already has an item
+   with KEY or if memory for a new node is not available.  An
+   allocation failure may leave empty nodes in R; they are
+   reclaimed by radix_destroy(). */
+bool
+radix_insert (struct radix *r, uint32_t key, void *item)
+{
+  struct radix_node *n;
+  size_t idx;
+  unsigned h;
+
+  ASSERT (r != NULL);
+  ASSERT (item != NULL);
+
+  if (!extend (r, key))
+    return false;
+  if (r->root == NULL)
+    {
+      r->root = node_alloc ();
+      if (r->root == NULL)
+        return false;
+    }
+
+  n = r->root;
+  for (h = r->height; h > 1; h--)
+    {
+      idx = slot_index (key, h);
+      if (n->slots[idx] == NULL)
+        {
+          struct radix_node *child = node_alloc ();
+          if (child == NULL)
+            return false;
+          n->slots[idx] = child;
+          n->count++;
+        }
+      n = n->slots[idx];
+    }
+
+  idx = slot_index (key, 1);
+  if (n->slots[idx] != NULL)
+    return false;
+  n->slots[idx] = item;
+  n->count++;
+  r->item_cnt++;
+  return true;
+}
+
+/* Returns the item in R with KEY, or a null pointer if there is
+   none. */
+void *
+radix_lookup (const struct radix *r, uint32_t key)
+{
+  void **slot = find_slot (r, key, NULL);
+  return slot != NULL ? *slot : NULL;
+}
+
+/* Removes the item with KEY from R and returns it, or returns a
+   null pointer if R has no item with KEY.  Nodes that become
+   empty are returned to the page allocator. */
+void *
+radix_delete (struct radix *r, uint32_t key)
+{
+  struct radix_node *path[RADIX_MAX_HEIGHT + 1];
+  void **slot = find_slot (r, key, path);
+  void *item;
+  unsigned h;
+  int tag;
+
+  if (slot == NULL || *slot == NULL)
+    return NULL;
+
+  item = *slot;
+  for (tag = 0; tag < RADIX_TAG_CNT; tag++)
+    clear_tag_path (r, path, key, tag);
+  *slot = NULL;
+  r->item_cnt--;
+
+  /* Free nodes that are now empty, from the leaf upward. */
+  for (h = 1; h <= r->height; h++)
+    {
+      struct radix_node *n = path[h];
+      if (--n->count > 0)
+        break;
+      node_free (n);
+      if (h == r->height)
+        {
+          r->root = NULL;
+          r->height = 0;
+          break;
+        }
+      path[h + 1]->slots[slot_index (key, h + 1)] = NULL;
+    }
+  shrink (r);
+
+  return item;
+}
+
+/* Tags the item in R with KEY, which must exist, with TAG. */
+void
+radix_tag_set (struct radix *r, uint32_t key, enum radix_tag tag)
+{
+  struct radix_node *path[RADIX_MAX_HEIGHT + 1];
+  void **slot = find_slot (r, key, path);
+  unsigned h;
+
+  ASSERT (tag < RADIX_TAG_CNT);
+  ASSERT (slot != NULL && *slot != NULL);
+
+  for (h = 1; h <= r->height; h++)
+    tag_mark (path[h], tag, slot_index (key, h));
+}
+
+/* Removes TAG from the item in R with KEY, if there is such an
+   item. */
+void
+radix_tag_clear (struct radix *r, uint32_t key, enum radix_tag tag)
+{
+  struct radix_node *path[RADIX_MAX_HEIGHT + 1];
+  void **slot = find_slot (r, key, path);
+
+  ASSERT (tag < RADIX_TAG_CNT);
+  if (slot != NULL && *slot != NULL)
+    clear_tag_path (r, path, key, tag);
+}
+
+/* Returns true if R has an item with KEY that is tagged with
+   TAG, false otherwise. */
+bool
+radix_tag_get (const struct radix *r, uint32_t key, enum radix_tag tag)
+{
+  struct radix_node *path[RADIX_MAX_HEIGHT + 1];
+  void **slot = find_slot (r, key, path);
+
+  ASSERT (tag < RADIX_TAG_CNT);
+  return (slot != NULL && *slot != NULL
+          && tag_test (path[1], tag, slot_index (key, 1)));
+}
+
+/* Returns true if any item in R is tagged with TAG.
+   Runs in O(1). */
+bool
+radix_tagged (const struct radix *r, enum radix_tag tag)
+{
+  ASSERT (tag < RADIX_TAG_CNT);
+  return r->root != NULL && tag_any (r->root, tag);
+}
+
+/* Stores up to MAX items from R into ITEMS, in increasing key
+   order, starting from the first item whose key is FIRST or
+   greater.  If KEYS is non-null, the item's keys are stored into
+   the corresponding elements of KEYS.  Returns the number of
+   items stored. */
+size_t
+radix_gang_lookup (const struct radix *r, uint32_t first,
+                   void **items, uint32_t *keys, size_t max)
+{
+  return gang_lookup (r, first, items, keys, max, ANY_TAG);
+}
+
+/* Like radix_gang_lookup(), but only considers items tagged with
+   TAG.  Untagged subtrees are skipped without being visited. */
+size_t
+radix_gang_lookup_tag (const struct radix *r, uint32_t first,
+                       void **items, uint32_t *keys, size_t max,
+                       enum radix_tag tag)
+{
+  ASSERT (tag < RADIX_TAG_CNT);
+  return gang_lookup (r, first, items, keys, max, tag);
+}
+
+/* Initializes I for iterating the items in R whose keys are
+   between FIRST and LAST, inclusive, in increasing key order.
+   Call radix_next() to obtain each item in turn.
+
+   The iterator looks up each item afresh, so the current item
+   may be deleted during iteration.  Items inserted during
+   iteration are visited if their keys have not yet been
+   passed. */
+void
+radix_first (struct radix_iterator *i, struct radix *r,
+             uint32_t first, uint32_t last)
+{
+  ASSERT (i != NULL);
+  ASSERT (r != NULL);
+
+  i->radix = r;
+  i->next = first;
+  i->last = last;
+  i->done = first > last;
+  i->key = 0;
+  i->item = NULL;
+}
+
+/* Advances I to the next item in its range and returns it, also
+   storing its key in I->key.  Returns a null pointer when no
+   items remain. */
+void *
+radix_next (struct radix_iterator *i)
+{
+  ASSERT (i != NULL);
+
+  i->item = NULL;
+  if (!i->done)
+    {
+      uint32_t key;
+      void *item = find_next (i->radix, i->next, ANY_TAG, &key);
+
+      if (item != NULL && key <= i->last)
+        {
+          i->item = item;
+          i->key = key;
+          if (key == i->last)
+            i->done = true;
+          else
+            i->next = key + 1;
+        }
+      else
+        i->done = true;
+    }
+  return i->item;
+}
+
+/* Returns the number of items in R. */
+size_t
+radix_size (const struct radix *r)
+{
+  return r->item_cnt;
+}
+
+/* Returns true if R contains no items, false otherwise. */
+bool
+radix_empty (const struct radix *r)
+{
+  return r->item_cnt == 0;
+}
+
+/* Makes R tall enough to hold KEY, adding new root nodes as
+   necessary.  Returns true if successful, false if memory for a
+   new root is not available. */
+static bool
+extend (struct radix *r, uint32_t key)
+{
+  unsigned height = r->height > 0 ? r->height : 1;
+
+  while (key > max_key (height))
+    height++;
+
+  if (r->root == NULL)
+    {
+      r->height = height;
+      return true;
+    }
+
+  while (r->height < height)
+    {
+      struct radix_node *n = node_alloc ();
+      int tag;
+
+      if (n == NULL)
+        return false;
+      n->slots[0] = r->root;
+      n->count = 1;
+      for (tag = 0; tag < RADIX_TAG_CNT; tag++)
+        if (tag_any (r->root, tag))
+          tag_mark (n, tag, 0);
+      r->root = n;
+      r->height++;
+    }
+  return true;
+}
+
+/* Removes root nodes whose only child is slot 0, since they
+   contribute nothing but an extra level to every lookup. */
+static void
+shrink (struct radix *r)
+{
+  while (r->height > 1 && r->root->count == 1 && r->root->slots[0] != NULL)
+    {
+      struct radix_node *child = r->root->slots[0];
+      node_free (r->root);
+      r->root = child;
+      r->height--;
+    }
+}
+
+/* Descends R toward KEY and returns a pointer to KEY's slot in a
+   leaf node, or a null pointer if the leaf does not exist.  If
+   PATH is non-null, PATH[H] is set to the node visited at
+   height H, for H from 1 to R's height. */
+static void **
+find_slot (const struct radix *r, uint32_t key, struct radix_node **path)
+{
+  struct radix_node *n = r->root;
+  unsigned h;
+
+  if (n == NULL || key > max_key (r->height))
+    return NULL;
+
+  for (h = r->height; ; h--)
+    {
+      if (path != NULL)
+        path[h] = n;
+      if (h == 1)
+        return &n->slots[slot_index (key, 1)];
+      n = n->slots[slot_index (key, h)];
+      if (n == NULL)
+        return NULL;
+    }
+}
+
+/* Removes TAG from KEY's slot in the nodes along PATH, stopping
+   at the first node that still has other slots tagged TAG. */
+static void
+clear_tag_path (struct radix *r, struct radix_node **path,
+                uint32_t key, int tag)
+{
+  unsigned h;
+
+  for (h = 1; h <= r->height; h++)
+    {
+      tag_reset (path[h], tag, slot_index (key, h));
+      if (tag_any (path[h], tag))
+        break;
+    }
+}
+
+/* Returns the index of the first slot in N at or after IDX that
+   is non-null or, if TAG is not ANY_TAG, tagged with TAG.
+   Returns RADIX_SLOTS if there is none. */
+static size_t
+next_slot (const struct radix_node *n, size_t idx, int tag)
+{
+  if (tag == ANY_TAG)
+    {
+      while (idx < RADIX_SLOTS && n->slots[idx] == NULL)
+        idx++;
+      return idx;
+    }
+
+  while (idx < RADIX_SLOTS)
+    {
+      uint32_t word = n->tags[tag][idx / 32] >> (idx % 32);
+      if (word != 0)
+        {
+          while ((word & 1) == 0)
+            {
+              word >>= 1;
+              idx++;
+            }
+          return idx;
+        }
+      idx = (idx / 32 + 1) * 32;
+    }
+  return RADIX_SLOTS;
+}
+
+/* Returns the first item at or after key START in the subtree
+   rooted at node N, which is at HEIGHT and covers keys starting
+   at BASE, considering only items tagged TAG unless TAG is
+   ANY_TAG.  Stores the item's key in *KEYP. */
+static void *
+search_node (struct radix_node *n, unsigned height, uint32_t base,
+             uint32_t start, int tag, uint32_t *keyp)
+{
+  unsigned shift = (height - 1) * RADIX_BITS;
+  size_t idx;
+
+  for (idx = next_slot (n, (start - base) >> shift, tag);
+       idx < RADIX_SLOTS;
+       idx = next_slot (n, idx + 1, tag))
+    {
+      uint32_t child_base = base + ((uint32_t) idx << shift);
+
+      if (height == 1)
+        {
+          *keyp = child_base;
+          return n->slots[idx];
+        }
+      else
+        {
+          uint32_t child_start = start > child_base ? start : child_base;
+          void *item = search_node (n->slots[idx], height - 1, child_base,
+                                    child_start, tag, keyp);
+          if (item != NULL)
+            return item;
+        }
+    }
+  return NULL;
+}
+
+/* Returns the first item in R with key START or greater,
+   considering only items tagged TAG unless TAG is ANY_TAG, and
+   stores its key in *KEYP.  Returns a null pointer if there is
+   no such item. */
+static void *
+find_next (const struct radix *r, uint32_t start, int tag, uint32_t *keyp)
+{
+  if (r->root == NULL || start > max_key (r->height))
+    return NULL;
+  return search_node (r->root, r->height, 0, start, tag, keyp);
+}
+
+/* Implements radix_gang_lookup() and radix_gang_lookup_tag(). */
+static size_t
+gang_lookup (const struct radix *r, uint32_t first,
+             void **items, uint32_t *keys, size_t max, int tag)
+{
+  size_t cnt = 0;
+
+  ASSERT (r != NULL);
+  ASSERT (items != NULL || max == 0);
+
+  while (cnt < max)
+    {
+      uint32_t key;
+      void *item = find_next (r, first, tag, &key);
+
+      if (item == NULL)
+        break;
+      items[cnt] = item;
+      if (keys != NULL)
+        keys[cnt] = key;
+      cnt++;
+
+      if (key == UINT32_MAX)
+        break;
+      first = key + 1;
+    }
+  return cnt;
+}
+
+/* Frees node N, which is at HEIGHT and covers keys starting at
+   BASE, and all of its descendants, calling DESTRUCTOR on each
+   item if it is non-null. */
+static void
+destroy_node (struct radix_node *n, unsigned height, uint32_t base,
+              radix_action_func *destructor, void *aux)
+{
+  unsigned shift = (height - 1) * RADIX_BITS;
+  size_t idx;
+
+  for (idx = 0; idx < RADIX_SLOTS; idx++)
+    if (n->slots[idx] != NULL)
+      {
+        uint32_t key = base + ((uint32_t) idx << shift);
+
+        if (height > 1)
+          destroy_node (n->slots[idx], height - 1, key, destructor, aux);
+        else if (destructor != NULL)
+          destructor (key, n->slots[idx], aux);
+      }
+  node_free (n);
+}
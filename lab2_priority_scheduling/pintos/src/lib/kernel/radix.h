@@ -0,0 +1,95 @@
+#ifndef __LIB_KERNEL_RADIX_H
+#define __LIB_KERNEL_RADIX_H
+
+/* Radix tree.
+
+   A radix tree maps 32-bit integer keys to non-null pointers.
+   It is meant for sparse integer-keyed indexes, such as tid to
+   thread, sector number to cached buffer, or user virtual page
+   number to frame, where a hash table would lose ordering and a
+   list would make lookups O(n).
+
+   The tree is made of page-sized nodes obtained from the page
+   allocator.  Each node consumes RADIX_BITS bits of the key, so
+   a lookup visits at most four nodes no matter how many items
+   the tree holds.  The tree only grows as tall as its largest
+   key requires, so a tree of small keys stays short.
+
+   Every item may additionally carry any of RADIX_TAG_CNT tags.
+   Tags are propagated up the tree, so finding the tagged items
+   (for example, all dirty buffers) skips untagged subtrees
+   entirely.
+
+   Unlike lists and hash tables, the tree does not embed
+   anything in the items themselves; it stores plain pointers.
+   Because nodes come from palloc_get_page(), the functions that
+   may allocate or free nodes must not be called from an
+   interrupt handler. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Item tags. */
+enum radix_tag
+  {
+    RADIX_TAG_DIRTY,            /* Item has been modified. */
+    RADIX_TAG_WRITEBACK,        /* Item is being written back. */
+    RADIX_TAG_CNT               /* Number of tags. */
+  };
+
+/* Radix tree. */
+struct radix
+  {
+    struct radix_node *root;    /* Root node, or null if empty. */
+    unsigned height;            /* Number of levels below root. */
+    size_t item_cnt;            /* Number of items in tree. */
+  };
+
+/* Iterator over the items in a range of keys, in key order. */
+struct radix_iterator
+  {
+    struct radix *radix;        /* The radix tree. */
+    uint32_t next;              /* Smallest key not yet visited. */
+    uint32_t last;              /* Largest key to visit. */
+    bool done;                  /* Range exhausted? */
+    uint32_t key;               /* Key of current item. */
+    void *item;                 /* Current item, or null. */
+  };
+
+/* Performs some operation on ITEM with key KEY, given auxiliary
+   data AUX. */
+typedef void radix_action_func (uint32_t key, void *item, void *aux);
+
+/* Basic life cycle. */
+void radix_init (struct radix *);
+void radix_destroy (struct radix *, radix_action_func *, void *aux);
+
+/* Search, insertion, deletion. */
+bool radix_insert (struct radix *, uint32_t key, void *item);
+void *radix_lookup (const struct radix *, uint32_t key);
+void *radix_delete (struct radix *, uint32_t key);
+
+/* Tags. */
+void radix_tag_set (struct radix *, uint32_t key, enum radix_tag);
+void radix_tag_clear (struct radix *, uint32_t key, enum radix_tag);
+bool radix_tag_get (const struct radix *, uint32_t key, enum radix_tag);
+bool radix_tagged (const struct radix *, enum radix_tag);
+
+/* Gang lookup. */
+size_t radix_gang_lookup (const struct radix *, uint32_t first,
+                          void **items, uint32_t *keys, size_t max);
+size_t radix_gang_lookup_tag (const struct radix *, uint32_t first,
+                              void **items, uint32_t *keys, size_t max,
+                              enum radix_tag);
+
+/* Range iteration. */
+void radix_first (struct radix_iterator *, struct radix *,
+                  uint32_t first, uint32_t last);
+void *radix_next (struct radix_iterator *);
+
+/* Information. */
+size_t radix_size (const struct radix *);
+bool radix_empty (const struct radix *);
+
+#endif /* lib/kernel/radix.h */
@@ -0,0 +1,113 @@
+#include <stats.h>
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/thread.h"
+
+/* Bounds of the ".stats" section, which holds a pointer to the
+   descriptor of every registered statistic.  See kernel.lds.S. */
+extern const struct stat_desc *const _start_stats[];
+extern const struct stat_desc *const _end_stats[];
+
+/* Interval between periodic snapshots, in milliseconds, or 0 if
+   periodic snapshots are disabled. */
+static unsigned snapshot_msec;
+
+static void print_stat (const struct stat_desc *);
+static thread_func snapshot_thread NO_RETURN;
+
+/* Requests that all statistics be printed every MSEC
+   milliseconds, starting when stats_init() is called.  Called
+   by the kernel command-line option parser. */
+void
+stats_configure (unsigned msec)
+{
+  if (msec == 0)
+    PANIC ("statistics snapshot interval must be positive");
+  snapshot_msec = msec;
+}
+
+/* Starts periodic snapshots, if they were requested by
+   stats_configure().  Must be called after the timer is
+   calibrated. */
+void
+stats_init (void)
+{
+  if (snapshot_msec != 0)
+    thread_create ("stats", PRI_MAX, snapshot_thread, NULL);
+}
+
+/* Prints every registered statistic, in the format described in
+   stats.h. */
+void
+stats_print (void)
+{
+  const struct stat_desc *const *d;
+
+  printf ("Stat: begin %"PRId64" ticks\n", timer_ticks ());
+  for (d = _start_stats; d < _end_stats; d++)
+    print_stat (*d);
+  printf ("Stat: end\n");
+}
+
+/* Prints the statistic described by D. */
+static void
+print_stat (const struct stat_desc *d)
+{
+  switch (d->type)
+    {
+    case STAT_TYPE_COUNTER:
+      {
+        const struct stat_counter *c = d->stat;
+
+        printf ("Stat: %s counter %"PRIu64"\n", d->name, stat_value (c));
+      }
+      break;
+
+    case STAT_TYPE_GAUGE:
+      {
+        const struct stat_gauge *g = d->stat;
+        int64_t value;
+
+        if (g->read != NULL)
+          value = g->read ();
+        else
+          value = stat_load_ ((const uint64_t *) &g->value);
+
+        printf ("Stat: %s gauge %"PRId64"\n", d->name, value);
+      }
+      break;
+
+    case STAT_TYPE_HISTOGRAM:
+      {
+        const struct stat_histogram *h = d->stat;
+        int b;
+
+        printf ("Stat: %s histogram %"PRIu64" %"PRIu64, d->name,
+                stat_load_ (&h->cnt), stat_load_ (&h->sum));
+        for (b = 0; b < STAT_HIST_BUCKETS; b++)
+          {
+            uint32_t cnt = h->buckets[b];
+            if (cnt != 0)
+              printf (" %d:%"PRIu32, b, cnt);
+          }
+        printf ("\n");
+      }
+      break;
+
+    default:
+      NOT_REACHED ();
+    }
+}
+
+/* Prints all statistics every snapshot_msec milliseconds. */
+static void
+snapshot_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_msleep (snapshot_msec);
+      stats_print ();
+    }
+}
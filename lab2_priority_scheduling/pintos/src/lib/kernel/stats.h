@@ -0,0 +1,222 @@
+#ifndef __LIB_KERNEL_STATS_H
+#define __LIB_KERNEL_STATS_H
+
+/* Kernel statistics registry.
+
+   A subsystem declares each statistic it keeps at file scope
+   with one of the STAT_* macros below, for example:
+
+      STAT_COUNTER (switch_cnt, "thread.switches");
+      STAT_GAUGE_FUNC (ready_gauge, "thread.ready", ready_count);
+      STAT_HISTOGRAM (wake_hist, "thread.wake_cycles");
+
+   and updates it with stat_inc(), stat_gauge_set(),
+   stat_hist_add(), and so on.  No initialization call is needed:
+   each macro places a pointer to a descriptor in the ".stats"
+   linker section, and stats_print() walks that section.
+
+   Updates are atomic read-modify-write operations, so any CPU
+   may update any statistic from any context, interrupt handlers
+   included, without losing updates, and stats_print() reads
+   each 64-bit value atomically, so it never sees one half
+   updated.  The fields of a histogram are updated one at a
+   time, though, so a histogram printed while another CPU is
+   adding to it may have a count, sum and buckets that disagree
+   by that one value.  An update costs a locked instruction,
+   which is slower than a plain one, and slower still when CPUs
+   contend for the same statistic.
+
+   stats_print() prints a block of lines that looks like this,
+   with one line per statistic, in link order:
+
+      Stat: begin TICKS ticks
+      Stat: NAME counter VALUE
+      Stat: NAME gauge VALUE
+      Stat: NAME histogram COUNT SUM BUCKET:COUNT...
+      Stat: end
+
+   where TICKS is the timer tick count at the time.  For a
+   histogram, BUCKET:COUNT pairs are given only for nonempty
+   buckets.  Bucket 0 counts the value 0 and bucket B > 0 counts
+   values in [2**(B-1), 2**B). */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of log2 buckets in a histogram. */
+#define STAT_HIST_BUCKETS 65
+
+/* Kinds of statistic. */
+enum stat_type
+  {
+    STAT_TYPE_COUNTER,          /* Monotonically increasing count. */
+    STAT_TYPE_GAUGE,            /* Value that goes up and down. */
+    STAT_TYPE_HISTOGRAM         /* Distribution of values. */
+  };
+
+/* A counter. */
+struct stat_counter
+  {
+    uint64_t value;
+  };
+
+/* A gauge, either set explicitly or, if READ is nonnull,
+   computed by calling READ when printed. */
+struct stat_gauge
+  {
+    int64_t value;
+    int64_t (*read) (void);
+  };
+
+/* A histogram of unsigned values. */
+struct stat_histogram
+  {
+    uint64_t cnt;                       /* Number of values added. */
+    uint64_t sum;                       /* Sum of values added. */
+    uint32_t buckets[STAT_HIST_BUCKETS];
+  };
+
+/* Describes a registered statistic.  Only for use by the STAT_*
+   macros and stats.c. */
+struct stat_desc
+  {
+    const char *name;           /* Name, conventionally "subsystem.what". */
+    enum stat_type type;        /* Kind of statistic. */
+    void *stat;                 /* The struct stat_* above. */
+  };
+
+/* Registers statistic VAR under NAME.  Implementation detail of
+   the STAT_* macros. */
+#define STAT_REGISTER_(VAR, NAME, TYPE)                                 \
+  static const struct stat_desc VAR##_desc_ = {NAME, TYPE, &VAR};       \
+  static const struct stat_desc *const VAR##_reg_                       \
+    __attribute__ ((section (".stats"), used)) = &VAR##_desc_
+
+/* Defines static counter VAR, registered as NAME. */
+#define STAT_COUNTER(VAR, NAME)                                         \
+  static struct stat_counter VAR;                                       \
+  STAT_REGISTER_ (VAR, NAME, STAT_TYPE_COUNTER)
+
+/* Defines static gauge VAR, registered as NAME. */
+#define STAT_GAUGE(VAR, NAME)                                           \
+  static struct stat_gauge VAR;                                         \
+  STAT_REGISTER_ (VAR, NAME, STAT_TYPE_GAUGE)
+
+/* Defines static gauge VAR, registered as NAME, whose value is
+   obtained by calling FUNC, which takes no arguments and returns
+   int64_t. */
+#define STAT_GAUGE_FUNC(VAR, NAME, FUNC)                                \
+  static struct stat_gauge VAR = {0, FUNC};                             \
+  STAT_REGISTER_ (VAR, NAME, STAT_TYPE_GAUGE)
+
+/* Defines static histogram VAR, registered as NAME. */
+#define STAT_HISTOGRAM(VAR, NAME)                                       \
+  static struct stat_histogram VAR;                                     \
+  STAT_REGISTER_ (VAR, NAME, STAT_TYPE_HISTOGRAM)
+
+/* If *P equals *OLD, atomically replaces *P by NEW and returns
+   true.  Otherwise, sets *OLD to *P and returns false.  Only for
+   use by the functions below and stats.c. */
+static inline bool
+stat_cas_ (uint64_t *p, uint64_t *old, uint64_t new)
+{
+  bool swapped;
+
+  asm volatile ("lock cmpxchg8b %1; sete %2"
+                : "+A" (*old), "+m" (*p), "=qm" (swapped)
+                : "b" ((uint32_t) new), "c" ((uint32_t) (new >> 32))
+                : "cc");
+  return swapped;
+}
+
+/* Atomically adds N to *P. */
+static inline void
+stat_add_ (uint64_t *p, uint64_t n)
+{
+  uint64_t old = *p;
+
+  while (!stat_cas_ (p, &old, old + n))
+    continue;
+}
+
+/* Atomically sets *P to VALUE. */
+static inline void
+stat_store_ (uint64_t *p, uint64_t value)
+{
+  uint64_t old = *p;
+
+  while (!stat_cas_ (p, &old, value))
+    continue;
+}
+
+/* Atomically reads *P.  (Swapping 0 for 0 changes nothing.) */
+static inline uint64_t
+stat_load_ (const uint64_t *p)
+{
+  uint64_t old = 0;
+
+  stat_cas_ ((uint64_t *) p, &old, 0);
+  return old;
+}
+
+/* Adds 1 to counter C. */
+static inline void
+stat_inc (struct stat_counter *c)
+{
+  stat_add_ (&c->value, 1);
+}
+
+/* Adds N to counter C. */
+static inline void
+stat_add (struct stat_counter *c, uint64_t n)
+{
+  stat_add_ (&c->value, n);
+}
+
+/* Returns the value of counter C. */
+static inline uint64_t
+stat_value (const struct stat_counter *c)
+{
+  return stat_load_ (&c->value);
+}
+
+/* Sets gauge G to VALUE. */
+static inline void
+stat_gauge_set (struct stat_gauge *g, int64_t value)
+{
+  stat_store_ ((uint64_t *) &g->value, value);
+}
+
+/* Adds DELTA, which may be negative, to gauge G. */
+static inline void
+stat_gauge_add (struct stat_gauge *g, int64_t delta)
+{
+  stat_add_ ((uint64_t *) &g->value, delta);
+}
+
+/* Adds VALUE to histogram H. */
+static inline void
+stat_hist_add (struct stat_histogram *h, uint64_t value)
+{
+  uint32_t hi = value >> 32;
+  uint32_t lo = value;
+  int bucket;
+
+  if (hi != 0)
+    bucket = 64 - __builtin_clz (hi);
+  else if (lo != 0)
+    bucket = 32 - __builtin_clz (lo);
+  else
+    bucket = 0;
+
+  stat_add_ (&h->cnt, 1);
+  stat_add_ (&h->sum, value);
+  asm volatile ("lock incl %0" : "+m" (h->buckets[bucket]) : : "cc");
+}
+
+void stats_configure (unsigned msec);
+void stats_init (void);
+void stats_print (void);
+
+#endif /* lib/kernel/stats.h */
@@ -0,0 +1,194 @@
+#ifndef __LIB_KERNEL_VEC_H
+#define __LIB_KERNEL_VEC_H
+
+/* Growable vector.
+
+   DEFINE_VEC (NAME, TYPE) defines `struct NAME', a dynamically
+   sized array of TYPE, along with a set of NAME_*() functions
+   that operate on it.  The elements are stored contiguously, so
+   iterating a vector touches far fewer cache lines than walking
+   a list of separately allocated elements, and indexing is
+   O(1).
+
+   When a vector runs out of room, its capacity is doubled, so a
+   sequence of N appends costs O(N) element copies in total.
+   Use NAME_reserve() to preallocate when the final size is
+   known, and NAME_shrink_to_fit() to give back unused capacity
+   once a vector stops growing.
+
+   For example, a vector of ints is defined and used like so:
+
+      DEFINE_VEC (int_vec, int);
+
+      struct int_vec v;
+      int *p;
+
+      int_vec_init (&v);
+      if (!int_vec_push_back (&v, 42))
+        ...handle out of memory...
+      for (p = int_vec_begin (&v); p != int_vec_end (&v); p++)
+        ...do something with *p...
+      int_vec_destroy (&v);
+
+   Pointers to elements are invalidated by any function that may
+   change the capacity, that is, NAME_reserve(),
+   NAME_push_back(), and NAME_shrink_to_fit().
+
+   Storage comes from malloc(), so vectors may not be modified
+   from an interrupt handler. */
+
+#include <debug.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+
+/* Smallest nonzero capacity a vector grows to. */
+#define VEC_MIN_CAPACITY 4
+
+#define DEFINE_VEC(NAME, TYPE)                                          \
+                                                                        \
+/* Vector of TYPE. */                                                   \
+struct NAME                                                             \
+  {                                                                     \
+    TYPE *data;                 /* Elements, or null if CAPACITY is 0. */ \
+    size_t size;                /* Number of elements in use. */        \
+    size_t capacity;            /* Number of elements allocated. */     \
+  };                                                                    \
+                                                                        \
+/* Initializes V as an empty vector, without allocating memory. */     \
+static inline void                                                      \
+NAME##_init (struct NAME *v)                                            \
+{                                                                       \
+  ASSERT (v != NULL);                                                   \
+  v->data = NULL;                                                       \
+  v->size = 0;                                                          \
+  v->capacity = 0;                                                      \
+}                                                                       \
+                                                                        \
+/* Frees V's storage, leaving it empty. */                              \
+static inline void                                                      \
+NAME##_destroy (struct NAME *v)                                         \
+{                                                                       \
+  free (v->data);                                                       \
+  NAME##_init (v);                                                      \
+}                                                                       \
+                                                                        \
+/* Changes V's capacity to exactly CAPACITY elements, which must be    \
+   at least V's size.  Returns true if successful, false if out of     \
+   memory, in which case V is unchanged. */                             \
+static inline bool                                                      \
+NAME##_set_capacity (struct NAME *v, size_t capacity)                   \
+{                                                                       \
+  TYPE *data;                                                           \
+                                                                        \
+  ASSERT (capacity >= v->size);                                         \
+  if (capacity == v->capacity)                                          \
+    return true;                                                        \
+  if (capacity == 0)                                                    \
+    {                                                                   \
+      NAME##_destroy (v);                                               \
+      return true;                                                      \
+    }                                                                   \
+  if (capacity > SIZE_MAX / sizeof (TYPE))                              \
+    return false;                                                       \
+                                                                        \
+  data = malloc (capacity * sizeof (TYPE));                             \
+  if (data == NULL)                                                     \
+    return false;                                                       \
+  if (v->size > 0)                                                      \
+    memcpy (data, v->data, v->size * sizeof (TYPE));                    \
+  free (v->data);                                                       \
+  v->data = data;                                                       \
+  v->capacity = capacity;                                               \
+  return true;                                                          \
+}                                                                       \
+                                                                        \
+/* Ensures that V can hold at least CAPACITY elements without          \
+   further allocation.  Returns true if successful, false if out of    \
+   memory. */                                                           \
+static inline bool                                                      \
+NAME##_reserve (struct NAME *v, size_t capacity)                        \
+{                                                                       \
+  return capacity <= v->capacity || NAME##_set_capacity (v, capacity);  \
+}                                                                       \
+                                                                        \
+/* Reduces V's capacity to its size.  Returns true if successful,      \
+   false if out of memory, in which case V is unchanged. */             \
+static inline bool                                                      \
+NAME##_shrink_to_fit (struct NAME *v)                                   \
+{                                                                       \
+  return NAME##_set_capacity (v, v->size);                              \
+}                                                                       \
+                                                                        \
+/* Appends VALUE to V, doubling V's capacity if it is full.            \
+   Returns true if successful, false if out of memory. */               \
+static inline bool                                                      \
+NAME##_push_back (struct NAME *v, TYPE value)                           \
+{                                                                       \
+  if (v->size == v->capacity)                                           \
+    {                                                                   \
+      size_t capacity = v->capacity * 2;                                \
+      if (capacity < VEC_MIN_CAPACITY)                                  \
+        capacity = VEC_MIN_CAPACITY;                                    \
+      if (!NAME##_set_capacity (v, capacity))                           \
+        return false;                                                   \
+    }                                                                   \
+  v->data[v->size++] = value;                                           \
+  return true;                                                          \
+}                                                                       \
+                                                                        \
+/* Removes and returns the last element of V, which must not be        \
+   empty.  The capacity is unchanged. */                                \
+static inline TYPE                                                      \
+NAME##_pop_back (struct NAME *v)                                        \
+{                                                                       \
+  ASSERT (v->size > 0);                                                 \
+  return v->data[--v->size];                                            \
+}                                                                       \
+                                                                        \
+/* Returns a pointer to element IDX of V, which must exist. */          \
+static inline TYPE *                                                    \
+NAME##_at (struct NAME *v, size_t idx)                                  \
+{                                                                       \
+  ASSERT (idx < v->size);                                               \
+  return &v->data[idx];                                                 \
+}                                                                       \
+                                                                        \
+/* Returns a pointer to V's first element, for iteration. */            \
+static inline TYPE *                                                    \
+NAME##_begin (struct NAME *v)                                           \
+{                                                                       \
+  return v->data;                                                       \
+}                                                                       \
+                                                                        \
+/* Returns a pointer just past V's last element, for iteration. */      \
+static inline TYPE *                                                    \
+NAME##_end (struct NAME *v)                                             \
+{                                                                       \
+  return v->data + v->size;                                             \
+}                                                                       \
+                                                                        \
+/* Returns the number of elements in V. */                              \
+static inline size_t                                                    \
+NAME##_size (const struct NAME *v)                                      \
+{                                                                       \
+  return v->size;                                                       \
+}                                                                       \
+                                                                        \
+/* Returns true if V has no elements, false otherwise. */               \
+static inline bool                                                      \
+NAME##_empty (const struct NAME *v)                                     \
+{                                                                       \
+  return v->size == 0;                                                  \
+}                                                                       \
+                                                                        \
+/* Removes all the elements from V.  The capacity is unchanged. */      \
+static inline void                                                      \
+NAME##_clear (struct NAME *v)                                           \
+{                                                                       \
+  v->size = 0;                                                          \
+}
+
+#endif /* lib/kernel/vec.h */
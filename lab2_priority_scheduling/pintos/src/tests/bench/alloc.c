@@ -0,0 +1,63 @@
+/* Measures allocator throughput: malloc() and free() of blocks
+   of assorted sizes, and palloc_get_page() and
+   palloc_free_page(). */
+
+#include <debug.h>
+#include "tests/bench/bench.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+
+/* Block sizes that malloc() requests cycle through, covering
+   several descriptors and the multi-page path. */
+static const size_t sizes[] = {16, 48, 200, 1000, 2000, 5000};
+#define SIZE_CNT (sizeof sizes / sizeof *sizes)
+
+/* Number of blocks held at a time in the batched test. */
+#define BATCH 64
+
+void
+bench_malloc (unsigned iters)
+{
+  void *blocks[BATCH];
+  uint64_t start;
+  unsigned i, j;
+
+  start = tsc_read ();
+  for (i = 0; i < iters; i++)
+    {
+      void *p = malloc (sizes[i % SIZE_CNT]);
+      if (p == NULL)
+        PANIC ("out of memory");
+      free (p);
+    }
+  bench_report ("malloc-free", iters, tsc_read () - start);
+
+  start = tsc_read ();
+  for (i = 0; i < iters; i += BATCH)
+    {
+      for (j = 0; j < BATCH; j++)
+        if ((blocks[j] = malloc (sizes[j % SIZE_CNT])) == NULL)
+          PANIC ("out of memory");
+      for (j = 0; j < BATCH; j++)
+        free (blocks[j]);
+    }
+  bench_report ("malloc-batch", (iters + BATCH - 1) / BATCH * BATCH,
+                tsc_read () - start);
+}
+
+void
+bench_palloc (unsigned iters)
+{
+  uint64_t start;
+  unsigned i;
+
+  start = tsc_read ();
+  for (i = 0; i < iters; i++)
+    palloc_free_page (palloc_get_page (PAL_ASSERT));
+  bench_report ("palloc-page", iters, tsc_read () - start);
+
+  start = tsc_read ();
+  for (i = 0; i < iters; i++)
+    palloc_free_multiple (palloc_get_multiple (PAL_ASSERT, 4), 4);
+  bench_report ("palloc-4pages", iters, tsc_read () - start);
+}
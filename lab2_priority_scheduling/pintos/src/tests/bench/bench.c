@@ -0,0 +1,72 @@
+#include "tests/threads/tests.h"
+#include "tests/bench/bench.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+struct bench
+  {
+    const char *name;
+    bench_func *function;
+  };
+
+static const struct bench benches[] =
+  {
+    {"switch", bench_switch},
+    {"sema", bench_sema},
+    {"lock", bench_lock},
+    {"sleep", bench_sleep},
+    {"malloc", bench_malloc},
+    {"palloc", bench_palloc},
+    {"memcpy", bench_memcpy},
+    {"block", bench_block},
+    {"trap", bench_trap},
+    {"clock", bench_clock},
+  };
+
+/* Runs the benchmark named NAME, or every benchmark if NAME is
+   "all", for ITERS iterations each. */
+void
+run_bench (const char *name, unsigned iters)
+{
+  const struct bench *b;
+  bool all = !strcmp (name, "all");
+  bool found = false;
+
+  if (iters == 0)
+    PANIC ("benchmark iteration count must be positive");
+
+  for (b = benches; b < benches + sizeof benches / sizeof *benches; b++)
+    if (all || !strcmp (name, b->name))
+      {
+        printf ("bench: begin %s iters=%u\n", b->name, iters);
+        b->function (iters);
+        printf ("bench: end %s\n", b->name);
+        found = true;
+      }
+  if (!found)
+    PANIC ("no benchmark named \"%s\"", name);
+}
+
+/* Reports that NAME performed OPS operations in CYCLES cycles.
+   The output is one line in a fixed format, so that host
+   scripts can extract and compare results across builds:
+
+     bench: NAME ops=OPS cycles=CYCLES cycles/op=CYCLES_PER_OP */
+void
+bench_report (const char *name, unsigned ops, uint64_t cycles)
+{
+  printf ("bench: %s ops=%u cycles=%"PRIu64" cycles/op=%"PRIu64"\n",
+          name, ops, cycles, ops > 0 ? cycles / ops : 0);
+}
+
+/* Reports that NAME's METRIC, which must be a single word, had
+   VALUE, as one line in the format:
+
+     bench: NAME METRIC=VALUE */
+void
+bench_metric (const char *name, const char *metric, uint64_t value)
+{
+  printf ("bench: %s %s=%"PRIu64"\n", name, metric, value);
+}
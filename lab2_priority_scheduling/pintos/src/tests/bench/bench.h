@@ -0,0 +1,51 @@
+#ifndef TESTS_BENCH_BENCH_H
+#define TESTS_BENCH_BENCH_H
+
+#include <stdint.h>
+#include "tests/threads/tests.h"
+#include "threads/tsc.h"
+
+/* Microbenchmarks.
+
+   The benchmarks declared with test_func are run like tests,
+   with "run NAME", and checked by "make check-bench".  The ones
+   declared with bench_func are run with the "bench NAME"
+   kernel action, or all together with "bench all", and perform
+   a caller-specified number of iterations.  Either kind reports
+   its results with bench_report(), and any results that are
+   not a cycle count with bench_metric(). */
+
+extern test_func test_bench_radix;
+extern test_func test_bench_vec;
+extern test_func test_malloc_uniform;
+extern test_func test_malloc_powerlaw;
+extern test_func test_malloc_prodcons;
+extern test_func test_malloc_mixed;
+extern test_func test_scale_sleep;
+extern test_func test_scale_donate;
+extern test_func test_scale_condvar;
+extern test_func test_scale_priority;
+extern test_func test_smp_scale;
+
+/* Default number of iterations for the "bench" action. */
+#define BENCH_DEFAULT_ITERS 10000
+
+/* A benchmark that performs ITERS iterations. */
+typedef void bench_func (unsigned iters);
+
+extern bench_func bench_switch;
+extern bench_func bench_sema;
+extern bench_func bench_lock;
+extern bench_func bench_sleep;
+extern bench_func bench_malloc;
+extern bench_func bench_palloc;
+extern bench_func bench_memcpy;
+extern bench_func bench_block;
+extern bench_func bench_trap;
+extern bench_func bench_clock;
+
+void run_bench (const char *name, unsigned iters);
+void bench_report (const char *name, unsigned ops, uint64_t cycles);
+void bench_metric (const char *name, const char *metric, uint64_t value);
+
+#endif /* tests/bench/bench.h */
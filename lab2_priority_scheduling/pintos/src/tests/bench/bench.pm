@@ -0,0 +1,32 @@
+use strict;
+use warnings;
+use tests::tests;
+
+# check_bench ($NAME)
+#
+# Checks the output of microbenchmark $NAME: it must begin, pass,
+# and end like any other test, and every other line must be a
+# result in the format printed by bench_report() or a line of one
+# or more METRIC=VALUE pairs like those printed by bench_metric().
+sub check_bench {
+    my ($name) = @_;
+    our ($test);
+
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+
+    my (@core) = get_core_output ("run", @output);
+    fail "Missing begin message.\n" if shift (@core) ne "($name) begin";
+    fail "Missing end message.\n" if pop (@core) ne "($name) end";
+    fail "Missing PASS message.\n" if pop (@core) ne "($name) PASS";
+
+    fail "No benchmark results.\n" if !@core;
+    foreach (@core) {
+	fail "Malformed benchmark result: $_\n"
+	  if !/^bench: \S+ ops=\d+ cycles=\d+ cycles\/op=\d+$/
+	     && !/^bench: \S+( \w+=\d+)+$/;
+    }
+    pass;
+}
+
+1;
@@ -0,0 +1,47 @@
+/* Measures block device read throughput, in sectors, on the
+   first block device found. */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "tests/bench/bench.h"
+#include "devices/block.h"
+#include "devices/ide.h"
+#include "threads/palloc.h"
+
+void
+bench_block (unsigned iters)
+{
+  struct block *block;
+  block_sector_t size;
+  uint8_t *buffer;
+  uint64_t start;
+  unsigned i;
+
+#ifndef FILESYS
+  /* Kernels without a file system don't initialize the disk
+     driver at boot, so do it now.  The disks themselves are
+     probed by block_first(), below. */
+  static bool probed;
+  if (!probed)
+    {
+      ide_init ();
+      probed = true;
+    }
+#endif
+
+  block = block_first ();
+  if (block == NULL)
+    {
+      printf ("bench: skipped block-read, no block device\n");
+      return;
+    }
+  size = block_size (block);
+  buffer = palloc_get_page (PAL_ASSERT);
+
+  start = tsc_read ();
+  for (i = 0; i < iters; i++)
+    block_read (block, i % size, buffer);
+  bench_report ("block-read", iters, tsc_read () - start);
+
+  palloc_free_page (buffer);
+}
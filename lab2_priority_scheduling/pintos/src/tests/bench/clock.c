@@ -0,0 +1,31 @@
+/* Measures reading the time through the clock page, which takes
+   no lock and turns off no interrupts, and counts the times it
+   ran backward, which should be none. */
+
+#include "tests/bench/bench.h"
+#include "devices/timer.h"
+
+void
+bench_clock (unsigned iters)
+{
+  uint64_t start, prev, now;
+  unsigned backward = 0;
+  unsigned i;
+
+  start = tsc_read ();
+  for (i = 0; i < iters; i++)
+    timer_ticks ();
+  bench_report ("clock-ticks", iters, tsc_read () - start);
+
+  prev = 0;
+  start = tsc_read ();
+  for (i = 0; i < iters; i++)
+    {
+      now = timer_now_ns ();
+      if (now < prev)
+        backward++;
+      prev = now;
+    }
+  bench_report ("clock-ns", iters, tsc_read () - start);
+  bench_metric ("clock-ns", "backward", backward);
+}
@@ -0,0 +1,62 @@
+/* Measures lock acquisition and release, first by a single
+   thread with no competition, then by two threads that each
+   yield while holding the lock, so that every acquisition
+   contends with the other thread and involves priority
+   donation. */
+
+#include "tests/bench/bench.h"
+#include "threads/lock.h"
+#include "threads/semaphore.h"
+#include "threads/thread.h"
+
+static struct lock lock;
+static struct semaphore finished;
+
+static void hold_and_yield (unsigned iters);
+static thread_func competitor;
+
+void
+bench_lock (unsigned iters)
+{
+  uint64_t start;
+  unsigned i;
+
+  lock_init (&lock);
+
+  start = tsc_read ();
+  for (i = 0; i < iters; i++)
+    {
+      lock_acquire (&lock);
+      lock_release (&lock);
+    }
+  bench_report ("lock-uncontended", iters, tsc_read () - start);
+
+  semaphore_init (&finished, 0);
+  start = tsc_read ();
+  thread_create ("competitor", thread_get_priority (), competitor, &iters);
+  hold_and_yield (iters);
+  semaphore_down (&finished);
+  bench_report ("lock-contended", 2 * iters, tsc_read () - start);
+}
+
+/* Acquires the lock ITERS times, yielding each time while
+   holding it. */
+static void
+hold_and_yield (unsigned iters)
+{
+  unsigned i;
+
+  for (i = 0; i < iters; i++)
+    {
+      lock_acquire (&lock);
+      thread_yield ();
+      lock_release (&lock);
+    }
+}
+
+static void
+competitor (void *iters)
+{
+  hold_and_yield (*(unsigned *) iters);
+  semaphore_up (&finished);
+}
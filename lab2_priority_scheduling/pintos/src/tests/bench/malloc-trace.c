@@ -0,0 +1,306 @@
+/* Replays synthetic allocation traces against malloc() and
+   against palloc_get_multiple(), as a baseline for allocator
+   changes.
+
+   Each test generates one kind of trace twice, with the same
+   random seed: once with block sizes suited to malloc(), once
+   with sizes of a few pages, which are rounded up to whole
+   pages and passed to palloc_get_multiple().  For each replay
+   NAME, it reports:
+
+     - Throughput, as cycles spent inside the allocator per
+       allocation or free, with bench_report().
+
+     - Periodic samples of the kernel pages the replay holds,
+       the percentage of those pages' bytes actually requested
+       (100 means no fragmentation), and the largest page_cnt
+       for which palloc_get_multiple() would still succeed, as
+       lines of the form
+
+         bench: NAME@OPS held=PAGES used_pct=PCT largest=PAGES
+
+     - Peak pages held, peak bytes requested, the smallest
+       largest-free-run seen, and the number of failed
+       allocations, with bench_metric().
+
+   The traces are:
+
+     malloc-uniform: sizes uniformly distributed, freed in
+     random order.
+
+     malloc-powerlaw: small sizes much more common than large
+     ones, freed in random order.
+
+     malloc-prodcons: a producer allocates and a consumer frees
+     in FIFO order, as with a queue of messages.
+
+     malloc-mixed: a few long-lived blocks, held until the end,
+     interleaved with many short-lived ones. */
+
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "tests/bench/bench.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define TRACE_OPS 8192          /* Allocations and frees per replay. */
+#define TRACE_SAMPLES 8         /* Samples per replay. */
+#define TRACE_MAX_LIVE 256      /* Most blocks live at once. */
+#define TRACE_PAGE_BUDGET 96    /* Most pages held before freeing. */
+#define TRACE_CHECK_OPS 16      /* Ops between memory use checks. */
+#define TRACE_SEED 0x5eed       /* Random seed for every trace. */
+
+/* Largest block sizes for each allocator. */
+#define MALLOC_MAX_SIZE 4096
+#define PALLOC_MAX_SIZE (8 * PGSIZE)
+
+/* Kinds of trace. */
+enum trace_kind
+  {
+    TRACE_UNIFORM,              /* Uniform sizes, random frees. */
+    TRACE_POWERLAW,             /* Power-law sizes, random frees. */
+    TRACE_PRODCONS,             /* Uniform sizes, FIFO frees. */
+    TRACE_MIXED                 /* Long- and short-lived blocks. */
+  };
+
+/* A live block. */
+struct block
+  {
+    void *p;                    /* The block. */
+    size_t size;                /* Bytes requested. */
+    bool long_lived;            /* Held until the end? */
+  };
+
+/* State of one replay. */
+struct replay
+  {
+    const char *name;           /* Name for reports. */
+    enum trace_kind kind;       /* Kind of trace. */
+    bool pages;                 /* Use palloc instead of malloc? */
+    size_t max_size;            /* Largest block size. */
+
+    struct block *blocks;       /* Live blocks, oldest first. */
+    unsigned live;              /* Number of live blocks. */
+    unsigned long_live;         /* Number of live long-lived blocks. */
+    size_t requested;           /* Bytes requested by live blocks. */
+    size_t base_free;           /* Free kernel pages at start. */
+    size_t held;                /* Pages held as of last check. */
+
+    unsigned ops;               /* Allocations and frees so far. */
+    uint64_t cycles;            /* Cycles spent in the allocator. */
+    unsigned failures;          /* Failed allocations. */
+    size_t peak_pages;          /* Most pages held. */
+    size_t peak_requested;      /* Most bytes requested. */
+    size_t min_largest;         /* Smallest largest free run. */
+  };
+
+/* Returns the number of kernel pages R currently holds. */
+static size_t
+held_pages (const struct replay *r)
+{
+  return r->base_free - palloc_free_cnt (0);
+}
+
+/* Returns a random size for the next block in R. */
+static size_t
+next_size (const struct replay *r)
+{
+  size_t max = r->max_size;
+
+  /* Picking a power-of-2 upper bound uniformly at random, then a
+     size below it, makes a size's frequency roughly inversely
+     proportional to the size. */
+  if (r->kind == TRACE_POWERLAW)
+    max >>= random_ulong () % (sizeof (unsigned) * 8 - __builtin_clz (max));
+  return 1 + random_ulong () % max;
+}
+
+/* Allocates a block of SIZE bytes in R.  Returns the block, or a
+   null pointer on failure. */
+static void *
+do_alloc (struct replay *r, size_t size)
+{
+  uint64_t start = tsc_read ();
+  void *p = (r->pages
+             ? palloc_get_multiple (0, DIV_ROUND_UP (size, PGSIZE))
+             : malloc (size));
+  r->cycles += tsc_read () - start;
+  return p;
+}
+
+/* Frees live block IDX in R, keeping the remaining blocks in
+   order. */
+static void
+free_block (struct replay *r, unsigned idx)
+{
+  struct block *b = &r->blocks[idx];
+  uint64_t start;
+
+  start = tsc_read ();
+  if (r->pages)
+    palloc_free_multiple (b->p, DIV_ROUND_UP (b->size, PGSIZE));
+  else
+    free (b->p);
+  r->cycles += tsc_read () - start;
+
+  r->requested -= b->size;
+  if (b->long_lived)
+    r->long_live--;
+  r->live--;
+  memmove (b, b + 1, (r->live - idx) * sizeof *b);
+}
+
+/* Frees one block in R, chosen according to R's kind of trace.
+   R must have a live block that is not long-lived. */
+static void
+free_one (struct replay *r)
+{
+  unsigned idx;
+
+  if (r->kind == TRACE_PRODCONS)
+    idx = 0;
+  else
+    do
+      idx = random_ulong () % r->live;
+    while (r->blocks[idx].long_lived);
+  free_block (r, idx);
+}
+
+/* Allocates one block in R, chosen according to R's kind of
+   trace. */
+static void
+alloc_one (struct replay *r)
+{
+  struct block *b = &r->blocks[r->live];
+
+  b->size = next_size (r);
+  b->long_lived = (r->kind == TRACE_MIXED
+                   && r->long_live < TRACE_MAX_LIVE / 4
+                   && r->held < TRACE_PAGE_BUDGET / 2
+                   && random_ulong () % 8 == 0);
+  b->p = do_alloc (r, b->size);
+  if (b->p == NULL)
+    {
+      r->failures++;
+      return;
+    }
+
+  r->requested += b->size;
+  if (b->long_lived)
+    r->long_live++;
+  r->live++;
+}
+
+/* Checks R's memory use and updates its peaks, printing a
+   sample if PRINT is true.  Scanning the page pool is slow
+   compared to an allocation, so this is only done every
+   TRACE_CHECK_OPS operations. */
+static void
+check (struct replay *r, bool print)
+{
+  size_t largest = palloc_largest_free (0);
+
+  r->held = held_pages (r);
+  if (r->held > r->peak_pages)
+    r->peak_pages = r->held;
+  if (r->requested > r->peak_requested)
+    r->peak_requested = r->requested;
+  if (largest < r->min_largest)
+    r->min_largest = largest;
+
+  if (print)
+    printf ("bench: %s@%u held=%zu used_pct=%zu largest=%zu\n",
+            r->name, r->ops, r->held,
+            r->held > 0 ? r->requested * 100 / (r->held * PGSIZE) : 100,
+            largest);
+}
+
+/* Replays a trace of KIND under NAME, against palloc if PAGES
+   is true, otherwise against malloc. */
+static void
+replay (const char *name, enum trace_kind kind, bool pages)
+{
+  struct replay r;
+
+  memset (&r, 0, sizeof r);
+  r.name = name;
+  r.kind = kind;
+  r.pages = pages;
+  r.max_size = pages ? PALLOC_MAX_SIZE : MALLOC_MAX_SIZE;
+  r.blocks = malloc (TRACE_MAX_LIVE * sizeof *r.blocks);
+  if (r.blocks == NULL)
+    fail ("out of memory");
+  r.base_free = palloc_free_cnt (0);
+  r.min_largest = palloc_largest_free (0);
+
+  random_init (TRACE_SEED);
+  for (r.ops = 0; r.ops < TRACE_OPS; r.ops++)
+    {
+      if (r.ops % TRACE_CHECK_OPS == 0)
+        check (&r, r.ops % (TRACE_OPS / TRACE_SAMPLES) == 0);
+
+      /* Allocate 3 times in 5, drifting toward full, unless
+         already full. */
+      if (r.live > r.long_live
+          && (r.live == TRACE_MAX_LIVE
+              || r.held >= TRACE_PAGE_BUDGET
+              || random_ulong () % 5 >= 3))
+        free_one (&r);
+      else if (r.live < TRACE_MAX_LIVE)
+        alloc_one (&r);
+    }
+  check (&r, true);
+
+  bench_report (name, TRACE_OPS, r.cycles);
+  bench_metric (name, "peak_pages", r.peak_pages);
+  bench_metric (name, "peak_requested", r.peak_requested);
+  bench_metric (name, "min_largest", r.min_largest);
+  bench_metric (name, "failures", r.failures);
+
+  while (r.live > 0)
+    free_block (&r, r.live - 1);
+  free (r.blocks);
+}
+
+/* Replays a trace of KIND against both allocators. */
+static void
+replay_both (const char *name, enum trace_kind kind)
+{
+  char full[32];
+
+  snprintf (full, sizeof full, "%s-malloc", name);
+  replay (full, kind, false);
+  snprintf (full, sizeof full, "%s-palloc", name);
+  replay (full, kind, true);
+  pass ();
+}
+
+void
+test_malloc_uniform (void)
+{
+  replay_both ("malloc-uniform", TRACE_UNIFORM);
+}
+
+void
+test_malloc_powerlaw (void)
+{
+  replay_both ("malloc-powerlaw", TRACE_POWERLAW);
+}
+
+void
+test_malloc_prodcons (void)
+{
+  replay_both ("malloc-prodcons", TRACE_PRODCONS);
+}
+
+void
+test_malloc_mixed (void)
+{
+  replay_both ("malloc-mixed", TRACE_MIXED);
+}
@@ -0,0 +1,250 @@
+/* Measures insertion, lookup, iteration, gang lookup, and
+   deletion in a radix tree, checking the results along the
+   way, then checks that tags are set, found, and cleared
+   correctly, including when items are deleted and the tree
+   shrinks.  The dense phase uses keys a small stride apart,
+   like sector numbers; the sparse phase scatters keys across
+   the whole 32-bit key space, like user virtual page numbers. */
+
+#include <debug.h>
+#include <radix.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "tests/bench/bench.h"
+#include "threads/malloc.h"
+
+#define DENSE_CNT 4096          /* Keys in dense phase. */
+#define DENSE_STRIDE 3          /* Distance between dense keys. */
+#define SPARSE_CNT 32           /* Keys in sparse phase. */
+#define GANG_CNT 64             /* Items per gang lookup. */
+#define TAG_STRIDE 7            /* Every TAG_STRIDE'th key is tagged. */
+
+/* Returns the item stored under KEY.  Items are never
+   dereferenced, so any non-null value will do. */
+static void *
+key_item (uint32_t key)
+{
+  return (void *) (uintptr_t) (key | 1);
+}
+
+/* Returns true if the N'th key is tagged by check_tags(). */
+static bool
+is_tagged (unsigned n)
+{
+  return n % TAG_STRIDE == 0;
+}
+
+/* Checks that R's items tagged TAG are exactly the tagged ones
+   among the CNT ascending KEYS, according to both
+   radix_tag_get() and radix_gang_lookup_tag(). */
+static void
+check_tagged (const char *phase, const struct radix *r, enum radix_tag tag,
+              const uint32_t *keys, unsigned cnt, bool (*tagged) (unsigned))
+{
+  void *items[GANG_CNT];
+  uint32_t gang_keys[GANG_CNT];
+  unsigned n, expected;
+  uint32_t first;
+
+  expected = 0;
+  for (n = 0; n < cnt; n++)
+    {
+      if (radix_tag_get (r, keys[n], tag) != tagged (n))
+        fail ("%s: key %u tag %d is %s", phase, keys[n], tag,
+              tagged (n) ? "clear" : "set");
+      if (tagged (n))
+        expected++;
+    }
+  if (radix_tagged (r, tag) != (expected > 0))
+    fail ("%s: tree says tag %d is %s", phase, tag,
+          expected > 0 ? "unused" : "used");
+
+  /* Walk the tagged gang lookup and the tagged keys in step. */
+  n = 0;
+  first = 0;
+  for (;;)
+    {
+      size_t got = radix_gang_lookup_tag (r, first, items, gang_keys,
+                                          GANG_CNT, tag);
+      size_t i;
+
+      for (i = 0; i < got; i++)
+        {
+          while (n < cnt && !tagged (n))
+            n++;
+          if (n >= cnt)
+            fail ("%s: tagged gang lookup found extra key %u",
+                  phase, gang_keys[i]);
+          if (gang_keys[i] != keys[n] || items[i] != key_item (keys[n]))
+            fail ("%s: tagged gang lookup found key %u, expected %u",
+                  phase, gang_keys[i], keys[n]);
+          n++;
+          expected--;
+        }
+      if (got < GANG_CNT || gang_keys[GANG_CNT - 1] == UINT32_MAX)
+        break;
+      first = gang_keys[GANG_CNT - 1] + 1;
+    }
+  if (expected != 0)
+    fail ("%s: tagged gang lookup missed %u keys", phase, expected);
+}
+
+/* Returns false: no key is tagged. */
+static bool
+never_tagged (unsigned n UNUSED)
+{
+  return false;
+}
+
+/* Returns true only for the first key. */
+static bool
+only_first (unsigned n)
+{
+  return n == 0;
+}
+
+/* Tags a subset of the CNT ascending KEYS in a tree of its own
+   and checks the tags as they are set, cleared, and dropped by
+   deleting items, down to a tree shrunk to a single item. */
+static void
+check_tags (const char *phase, const uint32_t *keys, unsigned cnt)
+{
+  struct radix r;
+  unsigned n;
+
+  radix_init (&r);
+  for (n = 0; n < cnt; n++)
+    if (!radix_insert (&r, keys[n], key_item (keys[n])))
+      fail ("%s: insert of key %u failed", phase, keys[n]);
+  check_tagged (phase, &r, RADIX_TAG_DIRTY, keys, cnt, never_tagged);
+
+  for (n = 0; n < cnt; n++)
+    if (is_tagged (n))
+      radix_tag_set (&r, keys[n], RADIX_TAG_DIRTY);
+  radix_tag_set (&r, keys[0], RADIX_TAG_WRITEBACK);
+  check_tagged (phase, &r, RADIX_TAG_DIRTY, keys, cnt, is_tagged);
+  check_tagged (phase, &r, RADIX_TAG_WRITEBACK, keys, cnt, only_first);
+
+  /* Drop every DIRTY tag, half by clearing it and half by
+     deleting the item, which must clear the tag up to the root.
+     Reinserting the deleted items must not bring their tags
+     back. */
+  for (n = 0; n < cnt; n++)
+    if (is_tagged (n))
+      {
+        if (n / TAG_STRIDE % 2 == 0)
+          radix_tag_clear (&r, keys[n], RADIX_TAG_DIRTY);
+        else if (radix_delete (&r, keys[n]) != key_item (keys[n]))
+          fail ("%s: delete of key %u failed", phase, keys[n]);
+      }
+  if (radix_tagged (&r, RADIX_TAG_DIRTY))
+    fail ("%s: tag %d still set after clearing or deleting every "
+          "tagged item", phase, RADIX_TAG_DIRTY);
+  for (n = 0; n < cnt; n++)
+    if (is_tagged (n) && n / TAG_STRIDE % 2 != 0
+        && !radix_insert (&r, keys[n], key_item (keys[n])))
+      fail ("%s: reinsert of key %u failed", phase, keys[n]);
+  check_tagged (phase, &r, RADIX_TAG_DIRTY, keys, cnt, never_tagged);
+  check_tagged (phase, &r, RADIX_TAG_WRITEBACK, keys, cnt, only_first);
+
+  /* Delete all but the first key, largest first, so that the
+     tree shrinks around it.  Its tag must survive. */
+  for (n = cnt - 1; n > 0; n--)
+    if (radix_delete (&r, keys[n]) != key_item (keys[n]))
+      fail ("%s: delete of key %u failed", phase, keys[n]);
+  check_tagged (phase, &r, RADIX_TAG_WRITEBACK, keys, 1, only_first);
+
+  if (radix_delete (&r, keys[0]) != key_item (keys[0]))
+    fail ("%s: delete of key %u failed", phase, keys[0]);
+  if (radix_tagged (&r, RADIX_TAG_WRITEBACK))
+    fail ("%s: tag %d still set in empty tree", phase,
+          RADIX_TAG_WRITEBACK);
+  radix_destroy (&r, NULL, NULL);
+}
+
+static void
+bench_keys (const char *phase, const uint32_t *keys, unsigned cnt)
+{
+  char name[32];
+  struct radix r;
+  struct radix_iterator i;
+  void *items[GANG_CNT];
+  uint32_t gang_keys[GANG_CNT];
+  uint64_t start;
+  unsigned n, found;
+
+  radix_init (&r);
+
+  start = tsc_read ();
+  for (n = 0; n < cnt; n++)
+    if (!radix_insert (&r, keys[n], key_item (keys[n])))
+      fail ("%s: insert of key %u failed", phase, keys[n]);
+  snprintf (name, sizeof name, "radix-%s-insert", phase);
+  bench_report (name, cnt, tsc_read () - start);
+
+  start = tsc_read ();
+  for (n = 0; n < cnt; n++)
+    if (radix_lookup (&r, keys[n]) != key_item (keys[n]))
+      fail ("%s: lookup of key %u failed", phase, keys[n]);
+  snprintf (name, sizeof name, "radix-%s-lookup", phase);
+  bench_report (name, cnt, tsc_read () - start);
+
+  found = 0;
+  start = tsc_read ();
+  radix_first (&i, &r, 0, UINT32_MAX);
+  while (radix_next (&i) != NULL)
+    found++;
+  snprintf (name, sizeof name, "radix-%s-iterate", phase);
+  bench_report (name, found, tsc_read () - start);
+  if (found != cnt)
+    fail ("%s: iteration found %u items, expected %u", phase, found, cnt);
+
+  found = 0;
+  start = tsc_read ();
+  for (;;)
+    {
+      uint32_t first = found > 0 ? gang_keys[GANG_CNT - 1] + 1 : 0;
+      size_t got = radix_gang_lookup (&r, first, items, gang_keys, GANG_CNT);
+      found += got;
+      if (got < GANG_CNT || gang_keys[GANG_CNT - 1] == UINT32_MAX)
+        break;
+    }
+  snprintf (name, sizeof name, "radix-%s-gang", phase);
+  bench_report (name, found, tsc_read () - start);
+  if (found != cnt)
+    fail ("%s: gang lookup found %u items, expected %u", phase, found, cnt);
+
+  start = tsc_read ();
+  for (n = 0; n < cnt; n++)
+    if (radix_delete (&r, keys[n]) != key_item (keys[n]))
+      fail ("%s: delete of key %u failed", phase, keys[n]);
+  snprintf (name, sizeof name, "radix-%s-delete", phase);
+  bench_report (name, cnt, tsc_read () - start);
+
+  if (!radix_empty (&r))
+    fail ("%s: tree not empty after deleting every key", phase);
+  radix_destroy (&r, NULL, NULL);
+}
+
+void
+test_bench_radix (void)
+{
+  uint32_t *keys = malloc (sizeof *keys * DENSE_CNT);
+  unsigned n;
+
+  if (keys == NULL)
+    fail ("out of memory");
+
+  for (n = 0; n < DENSE_CNT; n++)
+    keys[n] = n * DENSE_STRIDE;
+  bench_keys ("dense", keys, DENSE_CNT);
+  check_tags ("dense", keys, DENSE_CNT);
+
+  for (n = 0; n < SPARSE_CNT; n++)
+    keys[n] = (n + 1) * 0x07ffffffu;
+  bench_keys ("sparse", keys, SPARSE_CNT);
+  check_tags ("sparse", keys, SPARSE_CNT);
+
+  free (keys);
+  pass ();
+}
@@ -0,0 +1,367 @@
+/* Scalability stress tests for the scheduler and
+   synchronization primitives.
+
+   Each test repeats one scenario with N threads for N = 16, 64,
+   256, ..., as far as free kernel memory allows, checks that the
+   scenario behaved correctly, and reports its cost for each N
+   with bench_report().  Comparing cycles/op across the reports
+   for one scenario shows how its cost grows with N: constant
+   cycles/op means linear total cost, cycles/op proportional to
+   N means quadratic, and so on.
+
+   With the default 4 MB of memory, N reaches 256.  Run with
+   more memory, e.g. "make check-bench PINTOSOPTS='-m 64'", to reach
+   larger N. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "tests/bench/bench.h"
+#include "devices/timer.h"
+#include "threads/condvar.h"
+#include "threads/interrupt.h"
+#include "threads/lock.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/semaphore.h"
+#include "threads/thread.h"
+
+#define SCALE_MIN_THREADS 16    /* Smallest N. */
+#define SCALE_MAX_THREADS 4096  /* Largest N. */
+#define SCALE_FACTOR 4          /* Ratio between successive N. */
+
+/* Kernel pages left free for the test's own allocations,
+   beyond one page per thread. */
+#define SCALE_PAGE_MARGIN 64
+
+/* Returns the number of kernel pages that can currently be
+   allocated, by allocating all of them and freeing them
+   again. */
+static size_t
+free_kernel_pages (void)
+{
+  void *chain = NULL;
+  void *page;
+  size_t cnt = 0;
+
+  while ((page = palloc_get_page (0)) != NULL)
+    {
+      *(void **) page = chain;
+      chain = page;
+      cnt++;
+    }
+  while (chain != NULL)
+    {
+      page = chain;
+      chain = *(void **) page;
+      palloc_free_page (page);
+    }
+  return cnt;
+}
+
+/* Calls SCENARIO for each N that fits in memory. */
+static void
+for_each_size (void (*scenario) (unsigned n))
+{
+  unsigned n;
+
+  for (n = SCALE_MIN_THREADS; n <= SCALE_MAX_THREADS; n *= SCALE_FACTOR)
+    {
+      if (free_kernel_pages () < n + SCALE_PAGE_MARGIN)
+        {
+          if (n == SCALE_MIN_THREADS)
+            fail ("not enough memory for %u threads", n);
+          break;
+        }
+      scenario (n);
+    }
+}
+
+/* Reports CYCLES spent on N operations under NAME-N. */
+static void
+report (const char *name, unsigned n, uint64_t cycles)
+{
+  char full[32];
+
+  snprintf (full, sizeof full, "%s-%u", name, n);
+  bench_report (full, n, cycles);
+}
+
+/* Allocates an array of CNT elements of SIZE bytes, failing
+   the test if memory is exhausted. */
+static void *
+alloc_array (size_t cnt, size_t size)
+{
+  void *p = calloc (cnt, size);
+  if (p == NULL)
+    fail ("out of memory allocating %zu elements", cnt);
+  return p;
+}
+
+/* Creates a thread, failing the test if that is impossible. */
+static void
+spawn (const char *name, int priority, thread_func *func, void *aux)
+{
+  if (thread_create (name, priority, func, aux) == TID_ERROR)
+    fail ("thread_create failed");
+}
+
+/* Signaled by each worker thread when it is done. */
+static struct semaphore done;
+
+/* Waits for CNT workers to signal DONE. */
+static void
+wait_done (unsigned cnt)
+{
+  while (cnt-- > 0)
+    semaphore_down (&done);
+}
+
+/* scale-sleep: N threads sleep for different numbers of ticks
+   at once.  Measures the cost of creating the sleepers and
+   queuing them up, then checks that no one woke early. */
+
+/* Longest sleep, in ticks. */
+#define SLEEP_MAX_TICKS 16
+
+struct sleeper
+  {
+    int64_t ticks;              /* Duration of sleep. */
+    int64_t wake;               /* Earliest permissible wake time. */
+    int64_t woke;               /* Actual wake time. */
+  };
+
+static void
+sleeper_thread (void *s_)
+{
+  struct sleeper *s = s_;
+
+  s->wake = timer_ticks () + s->ticks;
+  timer_sleep (s->ticks);
+  s->woke = timer_ticks ();
+  semaphore_up (&done);
+}
+
+static void
+scale_sleep (unsigned n)
+{
+  struct sleeper *sleepers = alloc_array (n, sizeof *sleepers);
+  uint64_t start;
+  unsigned i;
+
+  /* Spread the durations so that sleepers are inserted in an
+     order unrelated to their wake times. */
+  for (i = 0; i < n; i++)
+    sleepers[i].ticks = 1 + i * 7919 % SLEEP_MAX_TICKS;
+
+  start = tsc_read ();
+  for (i = 0; i < n; i++)
+    spawn ("sleeper", PRI_DEFAULT + 1, sleeper_thread, &sleepers[i]);
+  report ("scale-sleep", n, tsc_read () - start);
+
+  wait_done (n);
+  for (i = 0; i < n; i++)
+    if (sleepers[i].woke < sleepers[i].wake)
+      fail ("sleeper %u woke at tick %"PRId64", expected %"PRId64" or later",
+            i, sleepers[i].woke, sleepers[i].wake);
+  free (sleepers);
+}
+
+void
+test_scale_sleep (void)
+{
+  semaphore_init (&done, 0);
+  for_each_size (scale_sleep);
+  pass ();
+}
+
+/* scale-donate: builds a chain of N threads, each holding one
+   lock and waiting for the lock held by the previous one, with
+   the main thread at the end of the chain.  Measures how long
+   it takes a PRI_MAX thread that joins the head of the chain to
+   donate its priority along all of it, then how long it takes
+   the whole chain to unwind once the main thread releases its
+   lock. */
+
+struct link
+  {
+    struct lock *mine;          /* Lock this thread holds. */
+    struct lock *prev;          /* Lock this thread waits for. */
+  };
+
+static void
+link_thread (void *l_)
+{
+  struct link *l = l_;
+
+  lock_acquire (l->mine);
+  lock_acquire (l->prev);
+  lock_release (l->prev);
+  lock_release (l->mine);
+  semaphore_up (&done);
+}
+
+static void
+scale_donate (unsigned n)
+{
+  struct lock *locks = alloc_array (n + 1, sizeof *locks);
+  struct link *links = alloc_array (n + 1, sizeof *links);
+  struct lock head_lock;
+  uint64_t start;
+  unsigned i;
+
+  for (i = 0; i <= n; i++)
+    lock_init (&locks[i]);
+  lock_acquire (&locks[0]);
+
+  /* Thread I holds lock I and waits for lock I - 1. */
+  for (i = 1; i <= n; i++)
+    {
+      links[i].mine = &locks[i];
+      links[i].prev = &locks[i - 1];
+      spawn ("link", PRI_DEFAULT + 1, link_thread, &links[i]);
+    }
+
+  /* The head waits for lock N, donating to every thread in the
+     chain and finally to us. */
+  lock_init (&head_lock);
+  links[0].mine = &head_lock;
+  links[0].prev = &locks[n];
+  start = tsc_read ();
+  spawn ("head", PRI_MAX, link_thread, &links[0]);
+  report ("scale-donate", n, tsc_read () - start);
+  if (thread_get_priority () != PRI_MAX)
+    fail ("priority %d after donation through %u threads, expected %d",
+          thread_get_priority (), n, PRI_MAX);
+
+  start = tsc_read ();
+  lock_release (&locks[0]);
+  report ("scale-unwind", n, tsc_read () - start);
+  if (thread_get_priority () != PRI_DEFAULT)
+    fail ("priority %d after unwinding, expected %d",
+          thread_get_priority (), PRI_DEFAULT);
+
+  wait_done (n + 1);
+  free (links);
+  free (locks);
+}
+
+void
+test_scale_donate (void)
+{
+  semaphore_init (&done, 0);
+  for_each_size (scale_donate);
+  pass ();
+}
+
+/* scale-condvar: N threads wait on one condition variable.
+   Measures the time from a broadcast until every waiter has
+   woken, reacquired the lock, and finished. */
+
+static struct lock cv_lock;
+static struct condvar cv;
+static bool cv_go;
+static unsigned cv_woken;
+
+static void
+waiter_thread (void *aux UNUSED)
+{
+  lock_acquire (&cv_lock);
+  while (!cv_go)
+    condvar_wait (&cv, &cv_lock);
+  cv_woken++;
+  lock_release (&cv_lock);
+  semaphore_up (&done);
+}
+
+static void
+scale_condvar (unsigned n)
+{
+  uint64_t start;
+  unsigned i;
+
+  cv_go = false;
+  cv_woken = 0;
+  for (i = 0; i < n; i++)
+    spawn ("waiter", PRI_DEFAULT + 1, waiter_thread, NULL);
+
+  lock_acquire (&cv_lock);
+  cv_go = true;
+  start = tsc_read ();
+  condvar_broadcast (&cv, &cv_lock);
+  lock_release (&cv_lock);
+  wait_done (n);
+  report ("scale-condvar", n, tsc_read () - start);
+
+  if (cv_woken != n)
+    fail ("%u of %u waiters woke", cv_woken, n);
+}
+
+void
+test_scale_condvar (void)
+{
+  lock_init (&cv_lock);
+  condvar_init (&cv);
+  semaphore_init (&done, 0);
+  for_each_size (scale_condvar);
+  pass ();
+}
+
+/* scale-priority: N threads with a spread of priorities below
+   the main thread's are created, queuing up on the ready list.
+   Measures the cost of creating them, then lowers the main
+   thread's priority and measures the time until all of them
+   have run, each lowering its own priority to the minimum as
+   it goes.  Checks that they first ran in priority order. */
+
+static int *pri_order;          /* Priorities in order of first run. */
+static unsigned pri_cnt;        /* Number of threads that have run. */
+
+static void
+priority_thread (void *aux UNUSED)
+{
+  enum intr_level old_level = intr_disable ();
+  pri_order[pri_cnt++] = thread_get_priority ();
+  intr_set_level (old_level);
+
+  thread_set_priority (PRI_MIN);
+  semaphore_up (&done);
+}
+
+static void
+scale_priority (unsigned n)
+{
+  uint64_t start;
+  unsigned i;
+
+  pri_order = alloc_array (n, sizeof *pri_order);
+  pri_cnt = 0;
+
+  start = tsc_read ();
+  for (i = 0; i < n; i++)
+    spawn ("pri", PRI_MIN + 1 + i * 7 % (PRI_DEFAULT - PRI_MIN - 1),
+           priority_thread, NULL);
+  report ("scale-priority-create", n, tsc_read () - start);
+
+  start = tsc_read ();
+  thread_set_priority (PRI_MIN);
+  wait_done (n);
+  report ("scale-priority-run", n, tsc_read () - start);
+  thread_set_priority (PRI_DEFAULT);
+
+  if (pri_cnt != n)
+    fail ("%u of %u threads ran", pri_cnt, n);
+  for (i = 1; i < n; i++)
+    if (pri_order[i] > pri_order[i - 1])
+      fail ("thread with priority %d ran after one with priority %d",
+            pri_order[i], pri_order[i - 1]);
+  free (pri_order);
+}
+
+void
+test_scale_priority (void)
+{
+  semaphore_init (&done, 0);
+  for_each_size (scale_priority);
+  pass ();
+}
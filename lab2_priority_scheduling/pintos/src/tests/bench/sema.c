@@ -0,0 +1,43 @@
+/* Measures a semaphore round trip between two threads: one
+   thread ups a semaphore the other is waiting on, then waits for
+   the other to up a second semaphore in reply. */
+
+#include "tests/bench/bench.h"
+#include "threads/semaphore.h"
+#include "threads/thread.h"
+
+static struct semaphore ping, pong;
+
+static thread_func ponger;
+
+void
+bench_sema (unsigned iters)
+{
+  uint64_t start;
+  unsigned i;
+
+  semaphore_init (&ping, 0);
+  semaphore_init (&pong, 0);
+  thread_create ("ponger", thread_get_priority (), ponger, &iters);
+
+  start = tsc_read ();
+  for (i = 0; i < iters; i++)
+    {
+      semaphore_up (&ping);
+      semaphore_down (&pong);
+    }
+  bench_report ("sema-pingpong", iters, tsc_read () - start);
+}
+
+static void
+ponger (void *iters_)
+{
+  unsigned iters = *(unsigned *) iters_;
+  unsigned i;
+
+  for (i = 0; i < iters; i++)
+    {
+      semaphore_down (&ping);
+      semaphore_up (&pong);
+    }
+}
@@ -0,0 +1,27 @@
+/* Measures timer_sleep() wakeup latency: the time from the timer
+   interrupt that ends a sleep until the sleeping thread runs
+   again. */
+
+#include "tests/bench/bench.h"
+#include "devices/timer.h"
+
+/* Each iteration takes a timer tick, so cap the iteration count
+   to keep the benchmark's running time reasonable. */
+#define SLEEP_MAX_ITERS 100
+
+void
+bench_sleep (unsigned iters)
+{
+  uint64_t latency = 0;
+  unsigned i;
+
+  if (iters > SLEEP_MAX_ITERS)
+    iters = SLEEP_MAX_ITERS;
+
+  for (i = 0; i < iters; i++)
+    {
+      timer_sleep (1);
+      latency += tsc_read () - timer_last_tick_tsc ();
+    }
+  bench_report ("sleep-wake", iters, latency);
+}
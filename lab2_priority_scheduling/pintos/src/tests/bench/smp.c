@@ -0,0 +1,92 @@
+/* Measures how CPU-bound work scales across CPUs.
+
+   For K = 1, 2, 4, ..., up to twice the number of CPUs, starts
+   K threads that each spin through the same fixed amount of
+   work, and reports the time until all of them finish as
+   smp-scale-K.  Each report also gives the number of CPUs and
+   the speedup over K = 1, as the percentage of K times the
+   single-thread time that the K threads took: 100 means
+   perfectly serial, K * 100 perfectly parallel.
+
+   With one CPU, the default, every K takes about K times as
+   long as K = 1.  Run with more, e.g. "make check-bench
+   PINTOSOPTS='--smp=4'", to see the threads spread across them
+   by work stealing.  Then the test fails unless each K of at
+   least 2 and at most the number of CPUs shows some speedup. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "tests/bench/bench.h"
+#include "threads/cpu.h"
+#include "threads/semaphore.h"
+#include "threads/thread.h"
+
+#define WORK_LOOPS 2000000      /* Iterations of work per thread. */
+
+/* Signaled by each worker thread when it is done. */
+static struct semaphore done;
+
+/* Spins through WORK_LOOPS iterations, then signals DONE. */
+static void
+worker (void *aux UNUSED)
+{
+  volatile unsigned sink = 0;
+  unsigned i;
+
+  for (i = 0; i < WORK_LOOPS; i++)
+    sink += i;
+  semaphore_up (&done);
+}
+
+/* Runs K workers to completion and returns the cycles taken. */
+static uint64_t
+run_workers (unsigned k)
+{
+  uint64_t start;
+  unsigned i;
+
+  semaphore_init (&done, 0);
+  start = tsc_read ();
+  for (i = 0; i < k; i++)
+    {
+      char name[20];
+
+      snprintf (name, sizeof name, "worker %u", i);
+      if (thread_create (name, PRI_DEFAULT, worker, NULL) == TID_ERROR)
+        fail ("thread_create failed");
+    }
+  for (i = 0; i < k; i++)
+    semaphore_down (&done);
+  return tsc_read () - start;
+}
+
+void
+test_smp_scale (void)
+{
+  unsigned max_k = 2 * cpu_count ();
+  uint64_t single = 0;
+  unsigned k;
+
+  for (k = 1; k <= max_k; k *= 2)
+    {
+      uint64_t cycles = run_workers (k);
+      uint64_t speedup;
+      char name[32];
+
+      if (k == 1)
+        single = cycles;
+      speedup = cycles > 0 ? single * k * 100 / cycles : 0;
+      snprintf (name, sizeof name, "smp-scale-%u", k);
+      bench_report (name, k, cycles);
+      bench_metric (name, "cpus", cpu_count ());
+      bench_metric (name, "speedup_pct", speedup);
+
+      /* Threads that each have a CPU of their own must finish
+         faster together than one after another. */
+      if (k > 1 && k <= cpu_count () && speedup <= 100)
+        fail ("%u threads on %u CPUs: speedup %" PRIu64 "%% "
+              "is not above 100%%", k, cpu_count (), speedup);
+    }
+  pass ();
+}
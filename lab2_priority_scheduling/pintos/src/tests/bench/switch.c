@@ -0,0 +1,40 @@
+/* Measures the cost of a context switch, by having two threads
+   of equal priority yield the CPU back and forth. */
+
+#include "tests/bench/bench.h"
+#include "threads/semaphore.h"
+#include "threads/thread.h"
+
+static volatile bool done;
+static struct semaphore finished;
+
+static thread_func yielder;
+
+void
+bench_switch (unsigned iters)
+{
+  uint64_t start, cycles;
+  unsigned i;
+
+  done = false;
+  semaphore_init (&finished, 0);
+  thread_create ("yielder", thread_get_priority (), yielder, NULL);
+
+  /* Each of our yields switches to the yielder and back. */
+  start = tsc_read ();
+  for (i = 0; i < iters; i++)
+    thread_yield ();
+  cycles = tsc_read () - start;
+
+  done = true;
+  semaphore_down (&finished);
+  bench_report ("switch", 2 * iters, cycles);
+}
+
+static void
+yielder (void *aux UNUSED)
+{
+  while (!done)
+    thread_yield ();
+  semaphore_up (&finished);
+}
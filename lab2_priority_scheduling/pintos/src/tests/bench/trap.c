@@ -0,0 +1,51 @@
+/* Measures the cost of entering the kernel through an interrupt
+   gate, the way user programs make system calls with
+   "int $0x30": a software interrupt to a handler that does
+   nothing, which goes through the IDT, the full register save
+   and restore in intr-stubs.S, and intr_handler()'s dispatch.
+   For comparison, also measures a plain call to the same
+   handler, the floor that a faster entry path such as
+   sysenter/sysexit could approach. */
+
+#include <debug.h>
+#include "tests/bench/bench.h"
+#include "threads/interrupt.h"
+
+/* Vector for the null trap.  Vector 0x30 is the system call
+   gate in kernels with user programs. */
+#define NULL_TRAP_VEC 0x31
+
+static intr_handler_func null_trap;
+
+void
+bench_trap (unsigned iters)
+{
+  static bool registered;
+  void (*volatile handler) (struct intr_frame *) = null_trap;
+  struct intr_frame frame;
+  uint64_t start;
+  unsigned i;
+
+  if (!registered)
+    {
+      intr_register_int (NULL_TRAP_VEC, 0, INTR_ON, null_trap, "Null trap");
+      registered = true;
+    }
+
+  start = tsc_read ();
+  for (i = 0; i < iters; i++)
+    asm volatile ("int %0" : : "i" (NULL_TRAP_VEC) : "memory");
+  bench_report ("trap-int", iters, tsc_read () - start);
+
+  frame.vec_no = NULL_TRAP_VEC;
+  start = tsc_read ();
+  for (i = 0; i < iters; i++)
+    handler (&frame);
+  bench_report ("trap-call", iters, tsc_read () - start);
+}
+
+/* Handler for the null trap, which does nothing. */
+static void
+null_trap (struct intr_frame *f UNUSED)
+{
+}
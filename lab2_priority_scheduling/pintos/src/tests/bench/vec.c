@@ -0,0 +1,100 @@
+/* Compares a growable vector against a list of separately
+   allocated elements holding the same values: appending every
+   value, summing them by iteration, and freeing them. */
+
+#include <list.h>
+#include <stdio.h>
+#include <vec.h>
+#include "tests/threads/tests.h"
+#include "tests/bench/bench.h"
+#include "threads/malloc.h"
+
+#define ELEM_CNT 4096           /* Elements appended per container. */
+
+DEFINE_VEC (int_vec, int);
+
+/* List element holding one value. */
+struct int_elem
+  {
+    struct list_elem elem;
+    int value;
+  };
+
+/* Returns the sum 0 + 1 + ... + (ELEM_CNT - 1). */
+static int
+expected_sum (void)
+{
+  return ELEM_CNT * (ELEM_CNT - 1) / 2;
+}
+
+static void
+bench_vec (void)
+{
+  struct int_vec v;
+  uint64_t start;
+  int *p;
+  int i, sum;
+
+  int_vec_init (&v);
+
+  start = tsc_read ();
+  for (i = 0; i < ELEM_CNT; i++)
+    if (!int_vec_push_back (&v, i))
+      fail ("out of memory appending to vector");
+  bench_report ("vec-append", ELEM_CNT, tsc_read () - start);
+
+  sum = 0;
+  start = tsc_read ();
+  for (p = int_vec_begin (&v); p != int_vec_end (&v); p++)
+    sum += *p;
+  bench_report ("vec-iterate", ELEM_CNT, tsc_read () - start);
+  if (sum != expected_sum ())
+    fail ("vector sum is %d, expected %d", sum, expected_sum ());
+
+  start = tsc_read ();
+  int_vec_destroy (&v);
+  bench_report ("vec-destroy", ELEM_CNT, tsc_read () - start);
+}
+
+static void
+bench_list (void)
+{
+  struct list l;
+  struct list_elem *e;
+  uint64_t start;
+  int i, sum;
+
+  list_init (&l);
+
+  start = tsc_read ();
+  for (i = 0; i < ELEM_CNT; i++)
+    {
+      struct int_elem *ie = malloc (sizeof *ie);
+      if (ie == NULL)
+        fail ("out of memory appending to list");
+      ie->value = i;
+      list_push_back (&l, &ie->elem);
+    }
+  bench_report ("list-append", ELEM_CNT, tsc_read () - start);
+
+  sum = 0;
+  start = tsc_read ();
+  for (e = list_begin (&l); e != list_end (&l); e = list_next (e))
+    sum += list_entry (e, struct int_elem, elem)->value;
+  bench_report ("list-iterate", ELEM_CNT, tsc_read () - start);
+  if (sum != expected_sum ())
+    fail ("list sum is %d, expected %d", sum, expected_sum ());
+
+  start = tsc_read ();
+  while (!list_empty (&l))
+    free (list_entry (list_pop_front (&l), struct int_elem, elem));
+  bench_report ("list-destroy", ELEM_CNT, tsc_read () - start);
+}
+
+void
+test_bench_vec (void)
+{
+  bench_vec ();
+  bench_list ();
+  pass ();
+}
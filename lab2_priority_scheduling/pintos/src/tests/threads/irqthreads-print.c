@@ -0,0 +1,55 @@
+/* Prints many lines from several threads of default priority,
+   far more than fit in the serial transmit queue.  Run with
+   -irqthreads, so that the serial port's interrupt handler runs
+   in a thread of its own that must keep up with the printing
+   threads. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/semaphore.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 4
+#define LINE_CNT 64
+
+static thread_func print_thread;
+
+/* Signaled by each printing thread when it is done. */
+static struct semaphore done;
+
+void
+test_irqthreads_print (void) 
+{
+  int ids[THREAD_CNT];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  semaphore_init (&done, 0);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+
+      ids[i] = i;
+      snprintf (name, sizeof name, "printer %d", i);
+      thread_create (name, PRI_DEFAULT, print_thread, &ids[i]);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    semaphore_down (&done);
+}
+
+static void
+print_thread (void *id_) 
+{
+  int *id = id_;
+  int i;
+
+  /* One printf() per line, so that lines are not interleaved
+     with those of other threads. */
+  for (i = 0; i < LINE_CNT; i++)
+    printf ("(irqthreads-print) Thread %d printing line %d of %d.\n",
+            *id, i, LINE_CNT);
+  semaphore_up (&done);
+}
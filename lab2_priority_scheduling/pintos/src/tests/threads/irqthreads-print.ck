@@ -0,0 +1,32 @@
+# -*- perl -*-
+
+# Each of the 4 threads must print all 64 of its lines, in order.
+# Lines from different threads may be interleaved in any way.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my ($thread_cnt) = 4;
+my ($line_cnt) = 64;
+my (@next) = (0) x $thread_cnt;
+
+foreach (@output) {
+    my ($id, $line) = /Thread (\d+) printing line (\d+) of/ or next;
+    fail "Unexpected thread $id.\n" if $id >= $thread_cnt;
+    fail "Thread $id printed line $line, expected line $next[$id].\n"
+      if $line != $next[$id];
+    $next[$id]++;
+}
+
+for my $id (0...$thread_cnt - 1) {
+    fail "Thread $id printed $next[$id] lines, expected $line_cnt.\n"
+      if $next[$id] != $line_cnt;
+}
+
+pass;
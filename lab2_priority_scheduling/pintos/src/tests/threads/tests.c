@@ -1,4 +1,5 @@
 #include "tests/threads/tests.h"
+#include "tests/bench/bench.h"
 #include <debug.h>
 #include <string.h>
 #include <stdio.h>
@@ -36,6 +37,19 @@ static const struct test tests[] =
 
     {"priority-donate-nest", test_priority_donate_nest},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"irqthreads-print", test_irqthreads_print},
+
+    {"radix", test_bench_radix},
+    {"vec", test_bench_vec},
+    {"malloc-uniform", test_malloc_uniform},
+    {"malloc-powerlaw", test_malloc_powerlaw},
+    {"malloc-prodcons", test_malloc_prodcons},
+    {"malloc-mixed", test_malloc_mixed},
+    {"scale-sleep", test_scale_sleep},
+    {"scale-donate", test_scale_donate},
+    {"scale-condvar", test_scale_condvar},
+    {"scale-priority", test_scale_priority},
+    {"smp-scale", test_smp_scale},
   };
 
 static const char *test_name;
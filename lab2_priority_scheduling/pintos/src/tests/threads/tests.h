@@ -29,6 +29,7 @@ extern test_func test_priority_donate_semaphore;
 extern test_func test_priority_donate_condvar;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_chain;
+extern test_func test_irqthreads_print;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,665 @@
+#include "threads/apic.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/pit.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* Local APIC and I/O APIC.
+
+   Every x86 CPU since the Pentium has a local APIC, which
+   delivers interrupts to that CPU and has a timer of its own,
+   and a PC's chipset has one or more I/O APICs, which route
+   device interrupt lines to local APICs.  Compared to the 8259
+   PICs, acknowledging an interrupt is a single write to
+   memory-mapped local APIC register instead of one or two slow
+   port writes, and each CPU gets its own timer.  The local
+   APICs also send the interprocessor interrupts that cpu.c uses
+   to start and wake the other CPUs.
+
+   We find the APICs through the Intel MultiProcessor
+   Specification tables that the BIOS builds, which also list
+   the CPUs.  Refer to [MP] and [IA32-v3a] chapter 8 "Advanced
+   Programmable Interrupt Controller (APIC)".  If there is no
+   APIC or no MP table, or the -noapic kernel option was given,
+   interrupt.c keeps using the 8259 PICs.
+
+   Device interrupt line N is routed to vector 0x20 + N, the same
+   vector as with the PICs, so drivers need not care which is in
+   use.  Device interrupts all go to the boot processor. */
+
+/* Local APIC registers, as byte offsets. */
+#define LAPIC_ID 0x020          /* Local APIC ID. */
+#define LAPIC_TPR 0x080         /* Task Priority Register. */
+#define LAPIC_EOI 0x0b0         /* End Of Interrupt. */
+#define LAPIC_SVR 0x0f0         /* Spurious Interrupt Vector Register. */
+#define LAPIC_ESR 0x280         /* Error Status Register. */
+#define LAPIC_ICR_LOW 0x300     /* Interrupt Command, bits 0-31. */
+#define LAPIC_ICR_HIGH 0x310    /* Interrupt Command, bits 32-63. */
+#define LAPIC_LVT_TIMER 0x320   /* Timer local vector table entry. */
+#define LAPIC_LVT_LINT0 0x350   /* LINT0 local vector table entry. */
+#define LAPIC_LVT_LINT1 0x360   /* LINT1 local vector table entry. */
+#define LAPIC_LVT_ERROR 0x370   /* Error local vector table entry. */
+#define LAPIC_TIMER_INIT 0x380  /* Timer initial count. */
+#define LAPIC_TIMER_CUR 0x390   /* Timer current count. */
+#define LAPIC_TIMER_DIV 0x3e0   /* Timer divide configuration. */
+
+/* Local APIC register bits. */
+#define SVR_ENABLE 0x100        /* APIC software enable. */
+#define LVT_MASKED 0x10000      /* Interrupt masked. */
+#define LVT_NMI 0x400           /* Delivery mode NMI. */
+#define LVT_PERIODIC 0x20000    /* Periodic timer mode. */
+#define TIMER_DIV_16 0x3        /* Timer counts at bus clock / 16. */
+#define ICR_INIT 0x500          /* Delivery mode INIT. */
+#define ICR_STARTUP 0x600       /* Delivery mode start-up. */
+#define ICR_PENDING 0x1000      /* Delivery status: send pending. */
+#define ICR_ASSERT 0x4000       /* Level: assert. */
+#define ICR_LEVEL 0x8000        /* Trigger mode: level. */
+
+/* Vector for local APIC spurious interrupts.  These must not be
+   acknowledged. */
+#define SPURIOUS_VEC 0xff
+
+/* I/O APIC registers, indirectly accessed through IOREGSEL and
+   IOWIN. */
+#define IOAPIC_REGSEL 0x00      /* Register select, as byte offset. */
+#define IOAPIC_WIN 0x10         /* Register window, as byte offset. */
+#define IOAPIC_VER 0x01         /* Version and max redirection entry. */
+#define IOAPIC_REDTBL(N) (0x10 + 2 * (N))  /* Redirection entry N. */
+
+/* I/O APIC redirection entry bits. */
+#define RED_ACTIVE_LOW 0x2000   /* Polarity: active low. */
+#define RED_LEVEL 0x8000        /* Trigger mode: level. */
+#define RED_MASKED 0x10000      /* Interrupt masked. */
+
+/* Model-specific register for the local APIC base. */
+#define MSR_APIC_BASE 0x1b
+#define APIC_BASE_ENABLE 0x800  /* Global enable. */
+
+/* MP floating pointer structure.  See [MP] 4.1. */
+struct mp_fp {
+    char signature[4]; /* "_MP_". */
+    uint32_t config; /* Physical address of configuration table. */
+    uint8_t length; /* Length in 16-byte units. */
+    uint8_t spec_rev; /* Specification revision. */
+    uint8_t checksum; /* Makes all bytes sum to 0. */
+    uint8_t features[5]; /* Nonzero features[0]: default config. */
+} __attribute__ ((packed));
+
+/* MP configuration table header.  See [MP] 4.2. */
+struct mp_config {
+    char signature[4]; /* "PCMP". */
+    uint16_t length; /* Length of header and entries. */
+    uint8_t spec_rev; /* Specification revision. */
+    uint8_t checksum; /* Makes all bytes sum to 0. */
+    char oem_id[8]; /* OEM name. */
+    char product_id[12]; /* Product name. */
+    uint32_t oem_table; /* OEM table physical address. */
+    uint16_t oem_table_size; /* OEM table size. */
+    uint16_t entry_cnt; /* Number of entries after the header. */
+    uint32_t lapic_addr; /* Local APIC physical address. */
+    uint16_t ext_length; /* Length of extended entries. */
+    uint8_t ext_checksum; /* Checksum of extended entries. */
+    uint8_t reserved;
+} __attribute__ ((packed));
+
+/* MP configuration table entry types. */
+enum mp_entry_type {
+    MP_PROCESSOR, /* A CPU, 20 bytes. */
+    MP_BUS, /* A bus, 8 bytes. */
+    MP_IOAPIC, /* An I/O APIC, 8 bytes. */
+    MP_IOINTR, /* An I/O interrupt assignment, 8 bytes. */
+    MP_LINTR /* A local interrupt assignment, 8 bytes. */
+};
+
+/* MP processor entry. */
+struct mp_processor {
+    uint8_t type; /* MP_PROCESSOR. */
+    uint8_t lapic_id; /* Local APIC ID. */
+    uint8_t lapic_ver; /* Local APIC version. */
+    uint8_t flags; /* Bit 0: enabled. */
+    uint8_t reserved[16];
+} __attribute__ ((packed));
+
+/* MP bus entry. */
+struct mp_bus {
+    uint8_t type; /* MP_BUS. */
+    uint8_t bus_id; /* Bus ID. */
+    char bus_type[6]; /* E.g. "ISA   " or "PCI   ". */
+} __attribute__ ((packed));
+
+/* MP I/O APIC entry. */
+struct mp_ioapic {
+    uint8_t type; /* MP_IOAPIC. */
+    uint8_t id; /* I/O APIC ID. */
+    uint8_t ver; /* I/O APIC version. */
+    uint8_t flags; /* Bit 0: enabled. */
+    uint32_t addr; /* Physical address. */
+} __attribute__ ((packed));
+
+/* MP I/O interrupt assignment entry. */
+struct mp_intr {
+    uint8_t type; /* MP_IOINTR. */
+    uint8_t intr_type; /* 0: vectored interrupt. */
+    uint16_t flags; /* Polarity in bits 0-1, trigger in 2-3. */
+    uint8_t src_bus; /* Source bus ID. */
+    uint8_t src_irq; /* Source bus IRQ. */
+    uint8_t dst_ioapic; /* Destination I/O APIC ID. */
+    uint8_t dst_intin; /* Destination I/O APIC input. */
+} __attribute__ ((packed));
+
+/* How a device interrupt line is routed to the I/O APIC. */
+struct irq_route {
+    int intin; /* I/O APIC input, or -1 if not routed. */
+    uint16_t flags; /* MP polarity and trigger flags. */
+};
+
+/* Number of ISA interrupt lines. */
+#define ISA_IRQ_CNT 16
+
+/* Set by -noapic. */
+static bool apic_disabled;
+
+/* True once the APICs are in use. */
+static bool enabled;
+
+/* Mapped local APIC and I/O APIC registers. */
+static volatile uint8_t *lapic;
+static volatile uint8_t *ioapic;
+
+/* CPUs listed in the MP table, by local APIC ID. */
+static uint8_t cpu_ids[APIC_MAX_CPUS];
+static unsigned cpu_cnt;
+
+/* Routing of each ISA interrupt line. */
+static struct irq_route isa_routes[ISA_IRQ_CNT];
+
+/* Local APIC timer count per tick, once calibrated. */
+static uint32_t timer_count;
+
+static bool find_mp(uint32_t *lapic_addr, uint32_t *ioapic_addr,
+    uint8_t *ioapic_id);
+static void *map_mmio(uint32_t paddr);
+static void lapic_init(void);
+static void ioapic_init(void);
+static void spurious_interrupt(struct intr_frame *);
+
+/* Keeps apic_init() from using the APICs. */
+void
+apic_disable(void)
+{
+    apic_disabled = true;
+}
+
+/* Reads 32-bit local APIC register REG. */
+static uint32_t
+lapic_read(unsigned reg)
+{
+    return *(volatile uint32_t *) (lapic + reg);
+}
+
+/* Writes VALUE to 32-bit local APIC register REG. */
+static void
+lapic_write(unsigned reg, uint32_t value)
+{
+    *(volatile uint32_t *) (lapic + reg) = value;
+}
+
+/* Reads I/O APIC register REG. */
+static uint32_t
+ioapic_read(unsigned reg)
+{
+    *(volatile uint32_t *) (ioapic + IOAPIC_REGSEL) = reg;
+    return *(volatile uint32_t *) (ioapic + IOAPIC_WIN);
+}
+
+/* Writes VALUE to I/O APIC register REG. */
+static void
+ioapic_write(unsigned reg, uint32_t value)
+{
+    *(volatile uint32_t *) (ioapic + IOAPIC_REGSEL) = reg;
+    *(volatile uint32_t *) (ioapic + IOAPIC_WIN) = value;
+}
+
+/* Returns true if the CPU has a local APIC. */
+static bool
+cpu_has_apic(void)
+{
+    uint32_t eax = 1, ebx, ecx, edx;
+
+    asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+    return (edx & (1u << 9)) != 0;
+}
+
+/* Finds and initializes the local APIC and the I/O APIC, and
+   routes device interrupts through them.  Returns true if
+   successful, false if the 8259 PICs should be used instead.
+   Must be called with interrupts off, after paging_init(). */
+bool
+apic_init(void)
+{
+    uint32_t lapic_addr, ioapic_addr;
+    uint8_t ioapic_id;
+    uint64_t apic_base;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (apic_disabled || !cpu_has_apic()
+        || !find_mp(&lapic_addr, &ioapic_addr, &ioapic_id)) {
+        printf("APIC: not in use, using 8259 PICs.\n");
+        return false;
+    }
+
+    lapic = map_mmio(lapic_addr);
+    ioapic = map_mmio(ioapic_addr);
+    if (lapic == NULL || ioapic == NULL) {
+        printf("APIC: registers overlap RAM, using 8259 PICs.\n");
+        return false;
+    }
+
+    /* Make sure the local APIC is globally enabled. */
+    asm volatile ("rdmsr" : "=A" (apic_base) : "c" (MSR_APIC_BASE));
+    if (!(apic_base & APIC_BASE_ENABLE)) {
+        apic_base |= APIC_BASE_ENABLE;
+        asm volatile ("wrmsr" : : "A" (apic_base), "c" (MSR_APIC_BASE));
+    }
+
+    intr_register_int(SPURIOUS_VEC, 0, INTR_OFF, spurious_interrupt,
+        "APIC Spurious");
+    lapic_init();
+    ioapic_init();
+    enabled = true;
+
+    printf("APIC: local APIC %"PRIu8" at %#"PRIx32
+        ", I/O APIC %"PRIu8" at %#"PRIx32", %u CPU(s).\n",
+        apic_id(), lapic_addr, ioapic_id, ioapic_addr, cpu_cnt);
+    return true;
+}
+
+/* Returns true if the APICs are in use. */
+bool
+apic_enabled(void)
+{
+    return enabled;
+}
+
+/* Acknowledges the interrupt being handled. */
+void
+apic_eoi(void)
+{
+    lapic_write(LAPIC_EOI, 0);
+}
+
+/* Returns the current CPU's local APIC ID. */
+uint8_t
+apic_id(void)
+{
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+/* Returns the number of CPUs listed in the MP table, at most
+   APIC_MAX_CPUS. */
+unsigned
+apic_cpu_cnt(void)
+{
+    return cpu_cnt;
+}
+
+/* Returns the local APIC ID of CPU IDX, which must be less than
+   apic_cpu_cnt(). */
+uint8_t
+apic_cpu_id(unsigned idx)
+{
+    ASSERT(idx < cpu_cnt);
+    return cpu_ids[idx];
+}
+
+/* Initializes the local APIC of an application processor.  Must
+   be called on that processor, with interrupts off, after
+   apic_init() succeeded on the boot processor. */
+void
+apic_init_ap(void)
+{
+    ASSERT(enabled);
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    lapic_init();
+}
+
+/* Sends an interprocessor interrupt with ICR value LOW to the CPU
+   whose local APIC ID is APIC_ID, and waits for the local APIC
+   to accept it for delivery. */
+static void
+send_ipi(uint8_t apic_id, uint32_t low)
+{
+    enum intr_level old_level = intr_disable();
+
+    lapic_write(LAPIC_ICR_HIGH, (uint32_t) apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, low);
+    while (lapic_read(LAPIC_ICR_LOW) & ICR_PENDING)
+        asm volatile ("pause");
+    intr_set_level(old_level);
+}
+
+/* Starts the application processor whose local APIC ID is
+   APIC_ID executing real-mode code at physical address
+   START_PADDR, which must be page-aligned and below 1 MB, with
+   the INIT, then twice start-up, interprocessor interrupt
+   sequence of [MP] B.4 "Application Processor Startup". */
+void
+apic_start_ap(uint8_t apic_id, uint32_t start_paddr)
+{
+    ASSERT(enabled);
+    ASSERT(start_paddr % PGSIZE == 0 && start_paddr < 0x100000);
+
+    send_ipi(apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+    pit_busy_wait(10000);
+    send_ipi(apic_id, ICR_STARTUP | (start_paddr >> 12));
+    pit_busy_wait(200);
+    send_ipi(apic_id, ICR_STARTUP | (start_paddr >> 12));
+    pit_busy_wait(200);
+}
+
+/* Puts the application processor whose local APIC ID is APIC_ID
+   back into its wait-for-startup state with an INIT
+   interprocessor interrupt, whatever it was doing. */
+void
+apic_stop_ap(uint8_t apic_id)
+{
+    ASSERT(enabled);
+
+    send_ipi(apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+    pit_busy_wait(10000);
+}
+
+/* Sends interrupt VEC to the CPU whose local APIC ID is
+   APIC_ID. */
+void
+apic_send_ipi(uint8_t apic_id, uint8_t vec)
+{
+    ASSERT(enabled);
+
+    send_ipi(apic_id, vec);
+}
+
+/* Initializes the current CPU's local APIC. */
+static void
+lapic_init(void)
+{
+    lapic_write(LAPIC_SVR, SVR_ENABLE | SPURIOUS_VEC);
+    lapic_write(LAPIC_TPR, 0);
+
+    /* LINT0 carries the 8259s' output in virtual wire mode, which
+       we no longer use.  LINT1 is NMI. */
+    lapic_write(LAPIC_LVT_LINT0, LVT_MASKED);
+    lapic_write(LAPIC_LVT_LINT1, LVT_NMI);
+    lapic_write(LAPIC_LVT_ERROR, LVT_MASKED);
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+
+    /* Clear errors and any interrupt in service. */
+    lapic_write(LAPIC_ESR, 0);
+    lapic_write(LAPIC_ESR, 0);
+    apic_eoi();
+}
+
+/* Programs I/O APIC input INTIN to deliver VEC to the current
+   CPU with the polarity and trigger mode in MP FLAGS, masked if
+   MASKED is true. */
+static void
+ioapic_route(int intin, uint8_t vec, uint16_t flags, bool masked)
+{
+    uint32_t low = vec;
+
+    /* Polarity 3 is active low, trigger mode 3 is level.
+       Anything else means active high and edge triggered, which
+       is what ISA interrupts are. */
+    if ((flags & 3) == 3)
+        low |= RED_ACTIVE_LOW;
+    if (((flags >> 2) & 3) == 3)
+        low |= RED_LEVEL;
+    if (masked)
+        low |= RED_MASKED;
+
+    ioapic_write(IOAPIC_REDTBL(intin) + 1, (uint32_t) apic_id() << 24);
+    ioapic_write(IOAPIC_REDTBL(intin), low);
+}
+
+/* Masks all I/O APIC inputs, then routes each ISA interrupt line
+   N to vector 0x20 + N. */
+static void
+ioapic_init(void)
+{
+    int max_intin = (ioapic_read(IOAPIC_VER) >> 16) & 0xff;
+    int i;
+
+    for (i = 0; i <= max_intin; i++)
+        ioapic_write(IOAPIC_REDTBL(i), RED_MASKED);
+
+    for (i = 0; i < ISA_IRQ_CNT; i++) {
+        const struct irq_route *r = &isa_routes[i];
+        if (r->intin >= 0 && r->intin <= max_intin)
+            ioapic_route(r->intin, 0x20 + i, r->flags, false);
+    }
+}
+
+/* Starts the current CPU's local APIC timer interrupting at
+   FREQUENCY Hz on vector VEC, and stops routing the 8254 PIT's
+   interrupt, line 0, which it replaces.  The timer is calibrated
+   against the PIT the first time.  Returns false, doing nothing,
+   if the APICs are not in use. */
+bool
+apic_timer_start(unsigned frequency, uint8_t vec)
+{
+    enum intr_level old_level;
+
+    if (!enabled)
+        return false;
+
+    old_level = intr_disable();
+    if (timer_count == 0) {
+        /* Count down from the maximum for 10 ms. */
+        uint32_t elapsed;
+
+        lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+        lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+        lapic_write(LAPIC_TIMER_INIT, UINT32_MAX);
+        pit_busy_wait(10000);
+        elapsed = UINT32_MAX - lapic_read(LAPIC_TIMER_CUR);
+        lapic_write(LAPIC_TIMER_INIT, 0);
+
+        timer_count = (uint64_t) elapsed * 100 / frequency;
+        if (timer_count == 0)
+            timer_count = 1;
+    }
+
+    lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LVT_PERIODIC | vec);
+    lapic_write(LAPIC_TIMER_INIT, timer_count);
+
+    if (isa_routes[0].intin >= 0)
+        ioapic_route(isa_routes[0].intin, 0x20, isa_routes[0].flags, true);
+    intr_set_level(old_level);
+    return true;
+}
+
+/* Handles a local APIC spurious interrupt by doing nothing,
+   not even acknowledging it. */
+static void
+spurious_interrupt(struct intr_frame *f UNUSED)
+{
+}
+
+/* Returns the sum of the SIZE bytes at P, modulo 256. */
+static uint8_t
+checksum(const void *p, size_t size)
+{
+    const uint8_t *bytes = p;
+    uint8_t sum = 0;
+
+    while (size-- > 0)
+        sum += *bytes++;
+    return sum;
+}
+
+/* Searches the SIZE bytes of physical memory starting at PADDR
+   for an MP floating pointer structure and returns it, or a null
+   pointer if there is none. */
+static struct mp_fp *
+search_mp_fp(uint32_t paddr, size_t size)
+{
+    uint8_t *p = ptov(paddr);
+    uint8_t *end = p + size;
+
+    for (; p + sizeof(struct mp_fp) <= end; p += 16) {
+        struct mp_fp *fp = (struct mp_fp *) p;
+        if (!memcmp(fp->signature, "_MP_", 4)
+            && checksum(fp, fp->length * 16) == 0)
+            return fp;
+    }
+    return NULL;
+}
+
+/* Finds the MP floating pointer structure, in the first KB of
+   the extended BIOS data area, the last KB of base memory, or
+   the BIOS ROM, in that order.  See [MP] 4. */
+static struct mp_fp *
+find_mp_fp(void)
+{
+    uint32_t ebda = *(uint16_t *) ptov(0x40e) << 4;
+    uint32_t base_kb = *(uint16_t *) ptov(0x413);
+    struct mp_fp *fp = NULL;
+
+    if (ebda != 0)
+        fp = search_mp_fp(ebda, 1024);
+    if (fp == NULL && base_kb >= 1)
+        fp = search_mp_fp(base_kb * 1024 - 1024, 1024);
+    if (fp == NULL)
+        fp = search_mp_fp(0xf0000, 0x10000);
+    return fp;
+}
+
+/* Reads the MP configuration table to find the local APIC's
+   address, the first enabled I/O APIC's address and ID, the
+   CPUs, and the routing of ISA interrupt lines to the I/O APIC.
+   Returns true if successful, false if there is no usable
+   table. */
+static bool
+find_mp(uint32_t *lapic_addr, uint32_t *ioapic_addr, uint8_t *ioapic_id)
+{
+    struct mp_fp *fp = find_mp_fp();
+    struct mp_config *config;
+    bool isa_bus[256];
+    bool have_ioapic = false;
+    bool have_routes = false;
+    uint8_t *entry;
+    int i;
+
+    /* We don't support the MP "default configurations", which
+       have no configuration table. */
+    if (fp == NULL || fp->features[0] != 0 || fp->config == 0
+        || fp->config >= init_ram_pages * PGSIZE)
+        return false;
+    config = ptov(fp->config);
+    if (memcmp(config->signature, "PCMP", 4)
+        || checksum(config, config->length) != 0)
+        return false;
+
+    *lapic_addr = config->lapic_addr;
+    memset(isa_bus, 0, sizeof isa_bus);
+    for (i = 0; i < ISA_IRQ_CNT; i++)
+        isa_routes[i].intin = -1;
+
+    entry = (uint8_t *) (config + 1);
+    for (i = 0; i < config->entry_cnt; i++) {
+        switch (*entry) {
+        case MP_PROCESSOR: {
+            struct mp_processor *p = (struct mp_processor *) entry;
+            if ((p->flags & 1) && cpu_cnt < APIC_MAX_CPUS)
+                cpu_ids[cpu_cnt++] = p->lapic_id;
+            entry += sizeof *p;
+            break;
+        }
+
+        case MP_BUS: {
+            struct mp_bus *b = (struct mp_bus *) entry;
+            isa_bus[b->bus_id] = !memcmp(b->bus_type, "ISA", 3);
+            entry += sizeof *b;
+            break;
+        }
+
+        case MP_IOAPIC: {
+            struct mp_ioapic *a = (struct mp_ioapic *) entry;
+            if ((a->flags & 1) && !have_ioapic) {
+                *ioapic_addr = a->addr;
+                *ioapic_id = a->id;
+                have_ioapic = true;
+            }
+            entry += sizeof *a;
+            break;
+        }
+
+        case MP_IOINTR: {
+            struct mp_intr *r = (struct mp_intr *) entry;
+            if (r->intr_type == 0 && isa_bus[r->src_bus]
+                && r->src_irq < ISA_IRQ_CNT && have_ioapic
+                && r->dst_ioapic == *ioapic_id) {
+                isa_routes[r->src_irq].intin = r->dst_intin;
+                isa_routes[r->src_irq].flags = r->flags;
+                have_routes = true;
+            }
+            entry += sizeof *r;
+            break;
+        }
+
+        case MP_LINTR:
+            entry += sizeof(struct mp_intr);
+            break;
+
+        default:
+            return false;
+        }
+    }
+
+    /* Without explicit assignments, ISA line N is I/O APIC input
+       N, except that line 2 is the cascade from the slave 8259. */
+    if (!have_routes)
+        for (i = 0; i < ISA_IRQ_CNT; i++)
+            if (i != 2)
+                isa_routes[i].intin = i;
+
+    return have_ioapic && cpu_cnt > 0;
+}
+
+/* Maps the page of device registers at physical address PADDR
+   into kernel virtual memory, uncached, and returns the virtual
+   address of PADDR.  The registers are mapped at the virtual
+   address equal to PADDR, which is free as long as it lies above
+   the kernel's mapping of RAM.  Returns a null pointer if it
+   does not. */
+static void *
+map_mmio(uint32_t paddr)
+{
+    uint32_t *pd = init_page_dir;
+    void *vaddr = (void *) paddr;
+    uint32_t *pt;
+
+    if (paddr < (uintptr_t) PHYS_BASE + init_ram_pages * PGSIZE)
+        return NULL;
+
+    if (pd[pd_no(vaddr)] == 0) {
+        pt = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+        pd[pd_no(vaddr)] = pde_create(pt);
+    } else
+        pt = pde_get_pt(pd[pd_no(vaddr)]);
+    pt[pt_no(vaddr)] = (paddr & PTE_ADDR) | PTE_P | PTE_W | PTE_PCD | PTE_PWT;
+    asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
+
+    return vaddr;
+}
@@ -0,0 +1,24 @@
+#ifndef THREADS_APIC_H
+#define THREADS_APIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Most CPUs that apic_init() records. */
+#define APIC_MAX_CPUS 8
+
+void apic_disable(void);
+bool apic_init(void);
+void apic_init_ap(void);
+bool apic_enabled(void);
+void apic_eoi(void);
+bool apic_timer_start(unsigned frequency, uint8_t vec);
+
+uint8_t apic_id(void);
+unsigned apic_cpu_cnt(void);
+uint8_t apic_cpu_id(unsigned idx);
+void apic_start_ap(uint8_t apic_id, uint32_t start_paddr);
+void apic_stop_ap(uint8_t apic_id);
+void apic_send_ipi(uint8_t apic_id, uint8_t vec);
+
+#endif /* threads/apic.h */
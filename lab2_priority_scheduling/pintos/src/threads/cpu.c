@@ -0,0 +1,226 @@
+#include "threads/cpu.h"
+
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "devices/timer.h"
+#include "threads/apic.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Symmetric multiprocessing.
+
+   The boot processor runs everything up to cpu_start_aps(),
+   which starts each application processor listed in the MP
+   table.  An AP starts in real mode in ap-start.S, which enters
+   protected mode and calls ap_main() on the stack of the AP's
+   idle thread, created for it in advance by cpu_start_aps().
+   ap_main() finishes setting up the AP's interrupt handling and
+   timer, then joins the scheduler in that idle thread.
+
+   From then on every CPU schedules threads from its own ready
+   list, and when that runs dry, steals from the others' (see
+   thread.c).  A CPU with nothing to do halts in its idle thread
+   until its next timer tick, unless another CPU "kicks" it with
+   an interprocessor interrupt to say there is work to steal.
+
+   The current CPU is found through the running thread, whose
+   `cpu' member the scheduler sets whenever it switches to the
+   thread. */
+
+/* Vector for the interprocessor interrupt sent by cpu_kick(). */
+#define KICK_VEC 0xf0
+
+/* Per-CPU state, indexed by CPU id. */
+struct cpu cpus[CPU_MAX];
+
+/* Most CPUs to run, set by -smp. */
+static unsigned cpu_max = CPU_MAX;
+
+/* Number of CPUs running, which are cpus[0] through
+   cpus[started_cnt - 1]. */
+static unsigned started_cnt = 1;
+
+/* Values of struct cpu's `startup' member.  An AP that comes up
+   and the boot processor that gives up waiting for it both swap
+   in their value, so exactly one of them sees the other's. */
+enum { AP_STARTING, AP_STARTED, AP_ABANDONED };
+
+/* True once the APs may be running.  Until then, every thread
+   runs on the boot processor. */
+static bool smp_started;
+
+/* AP startup code and its parameters, in ap-start.S. */
+extern char ap_start[], ap_start_end[];
+extern char ap_start_pd[], ap_start_esp[], ap_start_cpu[];
+extern char ap_start_gdtdesc[];
+
+void ap_main(struct cpu *) NO_RETURN;
+static bool start_ap(struct cpu *, uint8_t apic_id, uint8_t *code);
+static void kick_interrupt(struct intr_frame *);
+static uint32_t startup_swap(struct cpu *, uint32_t);
+
+/* Runs at most MAX CPUs, or only the boot processor if MAX is 0
+   or 1.  Called by the kernel command-line option parser. */
+void cpu_configure(unsigned max) {
+  cpu_max = max < 1 ? 1 : max > CPU_MAX ? CPU_MAX : max;
+}
+
+/* Returns the address of the parameter at SYM in the copy of the
+   AP startup code at CODE. */
+static void *start_param(uint8_t *code, char *sym) {
+  return code + (sym - ap_start);
+}
+
+/* Starts the application processors, up to the limit set by
+   -smp.  Does nothing if the APICs are not in use or there is
+   only one CPU.  Must be called on the boot processor, with
+   interrupts on and the timer calibrated. */
+void cpu_start_aps(void) {
+  uint8_t *code = ptov(AP_START_PHYS);
+  uint32_t *pd;
+  unsigned i;
+
+  ASSERT(intr_get_level() == INTR_ON);
+  ASSERT((size_t)(ap_start_end - ap_start) <= PGSIZE);
+
+  if (!apic_enabled() || apic_cpu_cnt() < 2 || cpu_max < 2)
+    return;
+
+  cpus[0].apic_id = apic_id();
+  intr_register_int(KICK_VEC, 0, INTR_OFF, kick_interrupt, "Kick IPI");
+
+  /* The APs enable paging while running at AP_START_PHYS, so
+     they start with a copy of the kernel's page directory that
+     also maps the first 4 MB of physical memory at virtual
+     address 0. */
+  pd = palloc_get_page(PAL_ASSERT);
+  memcpy(pd, init_page_dir, PGSIZE);
+  pd[0] = pd[pd_no(PHYS_BASE)];
+
+  memcpy(code, ap_start, ap_start_end - ap_start);
+  *(uint32_t *)start_param(code, ap_start_pd) = vtop(pd);
+  asm volatile("sgdt %0" : "=m"(*(uint8_t *)start_param(code, ap_start_gdtdesc)));
+
+  smp_started = true;
+  for (i = 0; i < apic_cpu_cnt() && started_cnt < cpu_max; i++) {
+    uint8_t id = apic_cpu_id(i);
+
+    if (id == cpus[0].apic_id)
+      continue;
+    if (!start_ap(&cpus[started_cnt], id, code)) {
+      printf("SMP: CPU with APIC ID %u did not start.\n", id);
+      break;
+    }
+    started_cnt++;
+  }
+  palloc_free_page(pd);
+
+  printf("SMP: %u CPUs running.\n", started_cnt);
+}
+
+/* Starts AP C, whose local APIC ID is APIC_ID, with the startup
+   code at CODE.  Returns true if it started, false if it did not
+   within 100 ms or there was not enough memory. */
+static bool start_ap(struct cpu *c, uint8_t apic_id, uint8_t *code) {
+  struct thread *idle;
+  int ms;
+
+  c->id = c - cpus;
+  c->apic_id = apic_id;
+  c->startup = AP_STARTING;
+  idle = thread_create_idle(c);
+  if (idle == NULL)
+    return false;
+
+  *(uint32_t *)start_param(code, ap_start_esp) = (uint32_t)idle + PGSIZE;
+  *(uint32_t *)start_param(code, ap_start_cpu) = (uint32_t)c;
+  apic_start_ap(apic_id, AP_START_PHYS);
+
+  for (ms = 0; ms < 100 && c->startup != AP_STARTED; ms++)
+    timer_mdelay(1);
+  if (startup_swap(c, AP_ABANDONED) == AP_STARTED)
+    return true;
+
+  /* The AP is late, but may still come up and use the startup
+     page directory and its idle thread's stack, which are about
+     to be freed.  Park it with INIT first. */
+  apic_stop_ap(apic_id);
+  thread_destroy_idle(c);
+  return false;
+}
+
+/* Atomically sets C's startup state to STATE and returns the old
+   state. */
+static uint32_t startup_swap(struct cpu *c, uint32_t state) {
+  asm volatile("xchgl %0, %1" : "+r"(state), "+m"(c->startup) : : "memory");
+  return state;
+}
+
+/* Entry point for AP C, called by ap-start.S on the stack of C's
+   idle thread, with interrupts off. */
+void ap_main(struct cpu *c) {
+  /* Switch to the kernel's own page directory. */
+  asm volatile("movl %0, %%cr3" : : "r"(vtop(init_page_dir)));
+
+  intr_init_ap();
+  apic_init_ap();
+  timer_init_ap();
+
+  /* If the boot processor gave up on us, it is about to park us
+     with INIT.  Touch nothing shared until then. */
+  if (startup_swap(c, AP_STARTED) == AP_ABANDONED)
+    for (;;)
+      asm volatile("cli; hlt");
+  c->started = true;
+
+  thread_start_ap();
+}
+
+/* Returns the CPU that is running this code.  Unless interrupts
+   are off, the running thread may move to another CPU at any
+   time, so the result is only good for as long as they stay
+   off. */
+struct cpu *cpu_current(void) {
+  struct thread *t;
+  uint32_t *esp;
+
+  if (!smp_started)
+    return &cpus[0];
+
+  /* Find the running thread, as running_thread() in thread.c
+     does. */
+  asm("mov %%esp, %0" : "=g"(esp));
+  t = pg_round_down(esp);
+  return t->cpu;
+}
+
+/* Returns the number of CPUs running. */
+unsigned cpu_count(void) { return started_cnt; }
+
+/* Makes CPU C look for threads to run, if it is halted in its
+   idle thread. */
+void cpu_kick(struct cpu *c) {
+  if (c != cpu_current() && c->idling)
+    apic_send_ipi(c->apic_id, KICK_VEC);
+}
+
+/* Handles a kick.  Interrupting the idle thread's `hlt' is all it
+   takes. */
+static void kick_interrupt(struct intr_frame *f UNUSED) { apic_eoi(); }
+
+/* Prints per-CPU statistics, if more than one CPU ran. */
+void cpu_print_stats(void) {
+  unsigned i;
+
+  if (started_cnt < 2)
+    return;
+  for (i = 0; i < started_cnt; i++)
+    printf("CPU %u: APIC ID %u, %u threads stolen\n", i, cpus[i].apic_id,
+           cpus[i].steals);
+}
@@ -0,0 +1,60 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+/* Physical address to which the application processor startup
+   code in ap-start.S is copied.  It must be page-aligned, below
+   1 MB, and clear of the loader's page at 0x7000, whose
+   command line is still in use. */
+#define AP_START_PHYS 0x6000
+
+#ifndef __ASSEMBLER__
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "threads/spinlock.h"
+
+/* Most CPUs supported. */
+#define CPU_MAX 8
+
+/* Per-CPU state.
+
+   The boot processor, or BSP, is cpus[0].  The others, the
+   application processors or APs, are started by cpu_start_aps()
+   once the kernel is up.  Each CPU has its own ready list, from
+   which it schedules threads, and steals threads from the others'
+   ready lists when its own is empty. */
+struct cpu {
+  unsigned id;                /* Index in cpus[]. */
+  uint8_t apic_id;            /* Local APIC ID. */
+  volatile bool started;      /* Running the scheduler? */
+  volatile uint32_t startup;  /* Startup handshake, see start_ap(). */
+
+  /* Owned by thread.c. */
+  struct thread *idle_thread; /* Runs when nothing else is ready. */
+  struct spinlock ready_lock; /* Protects ready_list. */
+  struct clist ready_list;    /* Threads ready to run, by priority. */
+  unsigned thread_ticks;      /* Timer ticks since last yield. */
+  bool preempting;            /* Is thread_preempt() yielding? */
+  volatile bool idling;       /* Halted in the idle thread? */
+  unsigned steals;            /* Threads taken from other CPUs. */
+
+  /* Owned by interrupt.c. */
+  unsigned intr_depth;     /* # of external interrupts being processed. */
+  int intr_priority;       /* Priority of the innermost one. */
+  bool intr_nestable;      /* Is its handler running with interrupts on? */
+  uint16_t intr_deferred;  /* IRQs held back until it finishes. */
+  bool yield_on_return;    /* Yield on interrupt return? */
+};
+
+extern struct cpu cpus[CPU_MAX];
+
+void cpu_configure(unsigned max);
+void cpu_start_aps(void);
+struct cpu *cpu_current(void);
+unsigned cpu_count(void);
+void cpu_kick(struct cpu *);
+void cpu_print_stats(void);
+#endif /* !__ASSEMBLER__ */
+
+#endif /* threads/cpu.h */
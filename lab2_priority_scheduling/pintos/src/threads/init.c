@@ -4,17 +4,21 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <random.h>
+#include <stats.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "devices/kbd.h"
 #include "devices/input.h"
+#include "devices/profile.h"
 #include "devices/serial.h"
 #include "devices/shutdown.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/apic.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -22,6 +26,8 @@
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/tsc.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -29,6 +35,7 @@
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #else
+#include "tests/bench/bench.h"
 #include "tests/threads/tests.h"
 #endif
 #ifdef FILESYS
@@ -57,11 +64,19 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+#ifndef USERPROG
+/* -bench-iters: Number of iterations for each benchmark. */
+static unsigned bench_iters = BENCH_DEFAULT_ITERS;
+#endif
+
 static void bss_init(void);
 static void paging_init(void);
+static void boot_stage(const char *name, uint64_t start);
+static void print_boot_timeline(void);
 
 static char **read_command_line(void);
 static char **parse_options(char **argv);
+static char *option_value(const char *name, char *value);
 static void run_actions(char **argv);
 static void usage(void);
 
@@ -70,6 +85,15 @@ static void locate_block_devices(void);
 static void locate_block_device(enum block_type, const char *name);
 #endif
 
+/* Runs CALL, a boot stage, and records its start and end times
+   under NAME in the boot timeline. */
+#define BOOT_STAGE(NAME, CALL)                  \
+    do {                                        \
+        uint64_t boot_start_ = tsc_read();      \
+        CALL;                                   \
+        boot_stage(NAME, boot_start_);          \
+    } while (0)
+
 /* Pintos main program. */
 int
 main(void)
@@ -77,54 +101,60 @@ main(void)
     char **argv;
 
     /* Clear BSS. */
-    bss_init();
+    BOOT_STAGE("bss_init", bss_init());
 
     /* Break command line into arguments and parse options. */
-    argv = read_command_line();
-    argv = parse_options(argv);
+    BOOT_STAGE("read_command_line", argv = read_command_line());
+    BOOT_STAGE("parse_options", argv = parse_options(argv));
 
     /* Initialize ourselves as a thread so we can use locks,
        then enable console locking. */
-    thread_init();
-    console_init();
+    BOOT_STAGE("thread_init", thread_init());
+    BOOT_STAGE("console_init", console_init());
 
     /* Greet user. */
     printf("Pintos booting with %'"PRIu32" kB RAM...\n",
         init_ram_pages * PGSIZE / 1024);
 
     /* Initialize memory system. */
-    palloc_init(user_page_limit);
-    malloc_init();
-    paging_init();
+    BOOT_STAGE("palloc_init", palloc_init(user_page_limit));
+    BOOT_STAGE("malloc_init", malloc_init());
+    BOOT_STAGE("paging_init", paging_init());
 
     /* Segmentation. */
 #ifdef USERPROG
-    tss_init();
-    gdt_init();
+    BOOT_STAGE("tss_init", tss_init());
+    BOOT_STAGE("gdt_init", gdt_init());
 #endif
 
     /* Initialize interrupt handlers. */
-    intr_init();
-    timer_init();
-    kbd_init();
-    input_init();
+    BOOT_STAGE("intr_init", intr_init());
+    BOOT_STAGE("timer_init", timer_init());
+    BOOT_STAGE("kbd_init", kbd_init());
+    BOOT_STAGE("input_init", input_init());
+    BOOT_STAGE("profile_init", profile_init());
+    BOOT_STAGE("trace_init", trace_init());
 #ifdef USERPROG
-    exception_init();
-    syscall_init();
+    BOOT_STAGE("exception_init", exception_init());
+    BOOT_STAGE("syscall_init", syscall_init());
 #endif
 
     /* Start thread scheduler and enable interrupts. */
-    thread_start();
-    serial_init_queue();
-    timer_calibrate();
+    BOOT_STAGE("thread_start", thread_start());
+    BOOT_STAGE("intr_start_threads", intr_start_threads());
+    BOOT_STAGE("serial_init_queue", serial_init_queue());
+    BOOT_STAGE("timer_calibrate", timer_calibrate());
+    BOOT_STAGE("stats_init", stats_init());
+    BOOT_STAGE("cpu_start_aps", cpu_start_aps());
 
 #ifdef FILESYS
     /* Initialize file system. */
-    ide_init();
-    locate_block_devices();
-    filesys_init(format_filesys);
+    BOOT_STAGE("ide_init", ide_init());
+    BOOT_STAGE("locate_block_devices", locate_block_devices());
+    BOOT_STAGE("filesys_init", filesys_init(format_filesys));
 #endif
 
+    print_boot_timeline();
     printf("Boot complete.\n");
 
     /* Run actions specified on kernel command line. */
@@ -148,6 +178,70 @@ bss_init(void)
     memset(&_start_bss, 0, &_end_bss - &_start_bss);
 }
 
+/* Maximum number of stages in the boot timeline. */
+#define BOOT_STAGE_MAX 32
+
+/* A stage in the boot timeline. */
+struct boot_stage {
+    const char *name; /* Name of stage. */
+    uint64_t start; /* Time-stamp counter at start. */
+    uint64_t end; /* Time-stamp counter at end. */
+};
+
+/* Boot timeline.  Stages are recorded in order. */
+static struct boot_stage boot_stages[BOOT_STAGE_MAX];
+static size_t boot_stage_cnt;
+
+/* Records in the boot timeline that stage NAME, which started
+   at time-stamp counter value START, has just ended.  Use the
+   BOOT_STAGE macro instead of calling this directly. */
+static void
+boot_stage(const char *name, uint64_t start)
+{
+    uint64_t end = tsc_read();
+
+    if (boot_stage_cnt < BOOT_STAGE_MAX) {
+        struct boot_stage *s = &boot_stages[boot_stage_cnt++];
+        s->name = name;
+        s->start = start;
+        s->end = end;
+    }
+}
+
+/* Prints one line of the boot timeline for a stage that started
+   at START and took CYCLES cycles, out of TOTAL. */
+static void
+print_boot_line(const char *name, uint64_t start, uint64_t cycles,
+    uint64_t total)
+{
+    unsigned permille = total > 0 ? cycles * 1000 / total : 0;
+
+    printf("Boot: %'16"PRIu64" %'16"PRIu64" %3u.%u%%  %s\n",
+        start, cycles, permille / 10, permille % 10, name);
+}
+
+/* Prints the boot timeline: when each boot stage started and
+   how many cycles it took, counted by the time-stamp counter
+   from processor reset.  Time before the first stage was spent
+   in the BIOS and the loader, and time between stages, which is
+   small, is attributed to no stage. */
+static void
+print_boot_timeline(void)
+{
+    uint64_t total = tsc_read();
+    size_t i;
+
+    printf("Boot: %16s %16s %6s  %s\n", "start", "cycles", "", "stage");
+    if (boot_stage_cnt > 0)
+        print_boot_line("(firmware and loader)", 0, boot_stages[0].start,
+            total);
+    for (i = 0; i < boot_stage_cnt; i++) {
+        const struct boot_stage *s = &boot_stages[i];
+        print_boot_line(s->name, s->start, s->end - s->start, total);
+    }
+    print_boot_line("(total)", 0, total, total);
+}
+
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
@@ -250,6 +344,28 @@ parse_options(char **argv)
             random_init(atoi(value));
         else if (!strcmp(name, "-mlfqs"))
             thread_mlfqs = true;
+        else if (!strcmp(name, "-lpt"))
+            timer_set_loops_per_tick(atoi(option_value(name, value)));
+        else if (!strcmp(name, "-noapic"))
+            apic_disable();
+        else if (!strcmp(name, "-smp"))
+            cpu_configure(atoi(option_value(name, value)));
+        else if (!strcmp(name, "-profile"))
+            profile_configure(value != NULL ? atoi(value) : PROFILE_DEFAULT_HZ);
+        else if (!strcmp(name, "-intrnest"))
+            intr_nest_configure();
+        else if (!strcmp(name, "-irqthreads"))
+            intr_threads_configure();
+        else if (!strcmp(name, "-introff"))
+            intr_off_configure(value != NULL ? atoi(value) : INTR_OFF_DEFAULT);
+#ifndef USERPROG
+        else if (!strcmp(name, "-bench-iters"))
+            bench_iters = atoi(option_value(name, value));
+#endif
+        else if (!strcmp(name, "-stats"))
+            stats_configure(atoi(option_value(name, value)));
+        else if (!strcmp(name, "-trace"))
+            trace_configure(value != NULL ? atoi(value) : TRACE_DEFAULT_PAGES);
 #ifdef USERPROG
         else if (!strcmp(name, "-ul"))
             user_page_limit = atoi(value);
@@ -271,6 +387,17 @@ parse_options(char **argv)
     return argv;
 }
 
+/* Returns VALUE, the value given for option NAME, or panics if
+   the option was given without one. */
+static char *
+option_value(const char *name, char *value)
+{
+    if (value == NULL)
+        PANIC("option `%s' requires a value, as in `%s=N' "
+              "(use -h for help)", name, name);
+    return value;
+}
+
 /* Runs the task specified in ARGV[1]. */
 static void
 run_task(char **argv)
@@ -286,6 +413,23 @@ run_task(char **argv)
     printf("Execution of '%s' complete.\n", task);
 }
 
+#ifndef USERPROG
+/* Runs the benchmark specified in ARGV[1]. */
+static void
+run_bench_action(char **argv)
+{
+    run_bench(argv[1], bench_iters);
+}
+#endif
+
+/* Prints statistics gathered so far, without shutting down. */
+static void
+run_stats(char **argv UNUSED)
+{
+    intr_print_stats();
+    stats_print();
+}
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -302,6 +446,10 @@ run_actions(char **argv)
     /* Table of supported actions. */
     static const struct action actions[] = {
         {"run", 2, run_task},
+        {"stats", 1, run_stats},
+#ifndef USERPROG
+        {"bench", 2, run_bench_action},
+#endif
 #ifdef FILESYS
         {"ls", 1, fsutil_ls},
         {"cat", 2, fsutil_cat},
@@ -348,6 +496,10 @@ usage(void)
         "  run 'PROG [ARG...]' Run PROG and wait for it to complete.\n"
 #else
         "  run TEST           Run TEST.\n"
+#endif
+        "  stats              Print kernel statistics.\n"
+#ifndef USERPROG
+        "  bench NAME         Run benchmark NAME, or \"all\" of them.\n"
 #endif
 #ifdef FILESYS
         "  ls                 List files in the root directory.\n"
@@ -371,6 +523,18 @@ usage(void)
 #endif
         "  -rs=SEED           Set random number seed to SEED.\n"
         "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+        "  -lpt=N             Skip timer calibration, using N loops/tick.\n"
+        "  -noapic            Use the 8259 PICs and 8254 timer, not the APICs.\n"
+        "  -smp=N             Run on at most N CPUs (default: all of them).\n"
+        "  -profile[=HZ]      Sample kernel call stacks HZ times a second.\n"
+        "  -introff[=N]       Report the N longest stretches with interrupts off.\n"
+        "  -intrnest          Let the timer interrupt preempt slow device interrupts.\n"
+        "  -irqthreads        Run keyboard and serial interrupt handlers in threads.\n"
+        "  -stats=MSEC        Print kernel statistics every MSEC ms.\n"
+#ifndef USERPROG
+        "  -bench-iters=N     Run each benchmark for N iterations.\n"
+#endif
+        "  -trace[=PAGES]     Trace scheduler events into PAGES pages.\n"
 #ifdef USERPROG
         "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -3,10 +3,14 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "threads/apic.h"
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/spinlock.h"
 #include "threads/thread.h"
+#include "threads/tsc.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
 
@@ -37,19 +41,143 @@ static const char *intr_names[INTR_CNT];
    unexpected interrupt is one that has no registered handler. */
 static unsigned int unexpected_cnt[INTR_CNT];
 
+/* Statistics for each vector.  Handler cycles are measured with
+   the TSC around the call to the handler, so for an internal
+   interrupt whose handler sleeps they include the time asleep. */
+struct intr_stats {
+    uint64_t cnt; /* # of times handled. */
+    uint64_t cycles; /* Total cycles in handler. */
+    uint64_t max_cycles; /* Longest single handler invocation. */
+    uint64_t yield_cnt; /* # of times handler requested a yield. */
+};
+static struct intr_stats intr_stats[INTR_CNT];
+
 /* External interrupts are those generated by devices outside the
    CPU, such as the timer.  External interrupts run with
    interrupts turned off, so they never nest, nor are they ever
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
    request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr; /* Are we processing an external interrupt? */
-static bool yield_on_return; /* Should we yield on interrupt return? */
+   interrupt returns.  Each CPU handles its own external
+   interrupts, so whether one is being processed, and whether to
+   yield on return, is kept per CPU, in struct cpu's intr_depth
+   and yield_on_return members.
+
+   The exception is nested interrupts, enabled with "-intrnest".
+   A driver whose handler is slow but can cope with running with
+   interrupts on may give its vector a priority lower than
+   INTR_PRI_MAX with intr_set_priority().  Its handler then runs
+   with interrupts on, after acknowledging the interrupt, so that
+   vectors of higher priority, including the timer and every
+   vector left at INTR_PRI_MAX, preempt it.  A vector of equal or
+   lower priority that arrives meanwhile is acknowledged and
+   deferred in software, and its handler runs once the handlers
+   that outrank it return.  Each nested interrupt uses more of
+   the interrupted thread's kernel stack, so a handler runs with
+   interrupts off instead if nesting it would leave less than
+   INTR_NEST_STACK_MIN bytes free or exceed INTR_NEST_MAX levels.
+   Deferral does not mask the interrupt line, so a nestable
+   vector must be edge-triggered, as ISA interrupts are. */
+#define INTR_NEST_MAX 4 /* Most nested external interrupts. */
+#define INTR_NEST_STACK_MIN 1024 /* Least stack to leave free. */
+static bool nest_enabled; /* Set by -intrnest. */
+static int8_t ext_priority[0x10]; /* For vectors 0x20...0x2f. */
+
+/* Nested interrupt statistics. */
+static unsigned nest_cnt; /* # of handlers run with interrupts on. */
+static unsigned nest_max_depth; /* Deepest nesting seen. */
+static size_t nest_min_free = SIZE_MAX; /* Least stack free seen. */
+static unsigned defer_cnt; /* # of interrupts deferred. */
+static unsigned refuse_cnt; /* # of times the limits prevented nesting. */
+
+static void handle_external(struct intr_frame *, struct cpu *);
+static void run_external(struct intr_frame *, struct cpu *, bool acked);
+static void call_handler(struct intr_frame *);
+
+/* Threaded interrupt handlers.
+
+   A handler registered with intr_register_threaded() may run in
+   a kernel thread of its own instead of in the interrupt, so
+   that device work runs at the priority its thread was given
+   and never delays more important threads.  The interrupt
+   itself only counts the request and wakes the thread, yielding
+   to it on return if it outranks the interrupted thread.  The
+   thread runs the handler once per request, with interrupts off
+   as usual, but a null intr_frame and without intr_context().
+
+   Handlers are only threaded if "-irqthreads" is given, and not
+   until intr_start_threads() runs, once the scheduler has
+   started.  Until then they run in the interrupt as if
+   registered with intr_register_ext(). */
+struct intr_thread {
+    intr_handler_func *handler; /* Handler to run in the thread. */
+    int priority; /* Thread priority. */
+    struct thread *thread; /* Thread, or null if not (yet) threaded. */
+    struct spinlock lock; /* Protects the members below. */
+    unsigned pending; /* # of interrupts not yet handled. */
+    bool waiting; /* Is THREAD blocked waiting for one? */
+    uint64_t runs; /* # of times THREAD ran the handler. */
+    uint64_t cycles; /* Total cycles THREAD spent in the handler. */
+};
+static struct intr_thread intr_threads[0x10]; /* For vectors 0x20...0x2f. */
+static bool threads_configured; /* Set by -irqthreads. */
+static bool threads_started; /* Has intr_start_threads() run? */
+
+static intr_handler_func threaded_interrupt;
+static thread_func intr_thread_func;
+static void start_intr_thread(uint8_t vec_no);
+
+/* Interrupts-off latency profiling.
+
+   When enabled with the "-introff" kernel option, every
+   transition of the interrupt flag from on to off (through
+   intr_disable(), intr_set_level(), or entry to an interrupt
+   gate) and back (through intr_enable(), intr_set_level(), or
+   return from an interrupt) is timestamped, and the longest
+   sections with interrupts off are kept along with where they
+   began and ended.
+
+   A few places turn interrupts on without going through this
+   file, most notably the idle thread's "sti; hlt".  A section
+   left open that way is discarded when the next interrupt
+   arrives, rather than charged with the time spent halted.
+
+   Only the boot processor is profiled. */
+
+/* Where a section with interrupts off began or ended: either
+   code that called one of the functions above, or an interrupt
+   entry or return. */
+struct off_site {
+    void *pc; /* Return address of caller, or null. */
+    int vec; /* Interrupt vector if PC is null. */
+};
+
+/* A section with interrupts off. */
+struct off_section {
+    uint64_t cycles; /* Length in TSC cycles. */
+    struct off_site begin; /* Where interrupts were turned off. */
+    struct off_site end; /* Where interrupts were turned back on. */
+};
+
+static unsigned off_keep; /* # of sections to keep, 0 if off. */
+static struct off_section off_top[INTR_OFF_MAX]; /* Longest first. */
+static unsigned off_kept; /* # of sections in off_top. */
+static uint64_t off_cnt; /* # of sections measured. */
+static uint64_t off_cycles; /* Total cycles with interrupts off. */
+static bool off_open; /* Is a section being measured? */
+static uint64_t off_start; /* TSC at start of current section. */
+static struct off_site off_begin_site; /* Start of current section. */
+
+static void off_begin(void *pc, int vec);
+static void off_end(void *pc, int vec);
+static void print_off_site(const struct off_site *);
+static enum intr_level enable_at(void *pc);
+static enum intr_level disable_at(void *pc);
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init(void);
 static void pic_end_of_interrupt(int irq);
+static void end_of_interrupt(int irq);
 
 /* Interrupt Descriptor Table helpers. */
 static uint64_t make_intr_gate(void (*) (void), int dpl);
@@ -80,15 +208,34 @@ intr_get_level(void)
 enum intr_level
 intr_set_level(enum intr_level level)
 {
-    return level == INTR_ON ? intr_enable() : intr_disable();
+    void *pc = __builtin_return_address(0);
+    return level == INTR_ON ? enable_at(pc) : disable_at(pc);
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable(void)
+{
+    return enable_at(__builtin_return_address(0));
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable(void)
+{
+    return disable_at(__builtin_return_address(0));
+}
+
+/* Enables interrupts on behalf of the caller at PC and returns
+   the previous interrupt status. */
+static enum intr_level
+enable_at(void *pc)
 {
     enum intr_level old_level = intr_get_level();
-    ASSERT(!intr_context());
+    ASSERT(!intr_context() || cpu_current()->intr_nestable);
+
+    if (old_level == INTR_OFF)
+        off_end(pc, -1);
 
     /* Enable interrupts by setting the interrupt flag.
 
@@ -99,9 +246,10 @@ intr_enable(void)
     return old_level;
 }
 
-/* Disables interrupts and returns the previous interrupt status. */
-enum intr_level
-intr_disable(void)
+/* Disables interrupts on behalf of the caller at PC and returns
+   the previous interrupt status. */
+static enum intr_level
+disable_at(void *pc)
 {
     enum intr_level old_level = intr_get_level();
 
@@ -110,9 +258,68 @@ intr_disable(void)
        Hardware Interrupts". */
     asm volatile ("cli" : : : "memory");
 
+    if (old_level == INTR_ON)
+        off_begin(pc, -1);
+
     return old_level;
 }
 
+/* Enables interrupts-off latency profiling, keeping the KEEP
+   longest sections.  Called by the kernel command-line option
+   parser. */
+void
+intr_off_configure(unsigned keep)
+{
+    if (keep == 0 || keep > INTR_OFF_MAX)
+        PANIC("can only keep 1 to %d interrupts-off sections", INTR_OFF_MAX);
+    off_keep = keep;
+}
+
+/* Starts timing a section with interrupts off that begins at
+   PC, or at interrupt VEC if PC is null.  Interrupts must be
+   off. */
+static void
+off_begin(void *pc, int vec)
+{
+    if (off_keep == 0 || cpu_current()->id != 0)
+        return;
+
+    off_open = true;
+    off_begin_site.pc = pc;
+    off_begin_site.vec = vec;
+    off_start = tsc_read();
+}
+
+/* Finishes timing the current section with interrupts off, if
+   any, which ends at PC, or at return from interrupt VEC if PC is
+   null, and remembers it if it is among the longest.  Interrupts
+   must be off. */
+static void
+off_end(void *pc, int vec)
+{
+    struct off_section *s;
+    uint64_t cycles;
+    unsigned i;
+
+    if (!off_open || cpu_current()->id != 0)
+        return;
+    cycles = tsc_read() - off_start;
+    off_open = false;
+    off_cnt++;
+    off_cycles += cycles;
+
+    if (off_kept == off_keep && cycles <= off_top[off_kept - 1].cycles)
+        return;
+    i = off_kept < off_keep ? off_kept++ : off_kept - 1;
+    for (; i > 0 && off_top[i - 1].cycles < cycles; i--)
+        off_top[i] = off_top[i - 1];
+    s = &off_top[i];
+    s->cycles = cycles;
+    s->begin = off_begin_site;
+    s->end.pc = pc;
+    s->end.vec = vec;
+}
+
 /* Initializes the interrupt system. */
 void
 intr_init(void)
@@ -133,6 +340,11 @@ intr_init(void)
     idtr_operand = make_idtr_operand(sizeof idt - 1, idt);
     asm volatile ("lidt %0" : : "m" (idtr_operand));
 
+    /* External interrupts don't nest until a driver says they
+       may. */
+    for (i = 0; i < 0x10; i++)
+        ext_priority[i] = INTR_PRI_MAX;
+
     /* Initialize intr_names. */
     for (i = 0; i < INTR_CNT; i++)
         intr_names[i] = "unknown";
@@ -155,6 +367,22 @@ intr_init(void)
     intr_names[17] = "#AC Alignment Check Exception";
     intr_names[18] = "#MC Machine-Check Exception";
     intr_names[19] = "#XF SIMD Floating-Point Exception";
+
+    /* Switch to the APICs if there are any.  From then on the
+       8259s stay masked. */
+    if (apic_init()) {
+        outb(PIC0_DATA, 0xff);
+        outb(PIC1_DATA, 0xff);
+    }
+}
+
+/* Initializes interrupt handling on an application processor,
+   which shares the boot processor's IDT. */
+void
+intr_init_ap(void)
+{
+    uint64_t idtr_operand = make_idtr_operand(sizeof idt - 1, idt);
+    asm volatile ("lidt %0" : : "m" (idtr_operand));
 }
 
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
@@ -185,6 +413,158 @@ intr_register_ext(uint8_t vec_no, intr_handler_func *handler,
     register_handler(vec_no, 0, INTR_OFF, handler, name);
 }
 
+/* Sets the priority of external interrupt VEC_NO to PRIORITY,
+   between 0 and INTR_PRI_MAX.  If nested interrupts are enabled
+   and PRIORITY is less than INTR_PRI_MAX, VEC_NO's handler runs
+   with interrupts on, and may be preempted by interrupts of
+   higher priority, so it must turn interrupts off itself where
+   it needs to.  VEC_NO must be edge-triggered. */
+void
+intr_set_priority(uint8_t vec_no, int priority)
+{
+    ASSERT(vec_no >= 0x20 && vec_no <= 0x2f);
+    ASSERT(priority >= 0 && priority <= INTR_PRI_MAX);
+    ext_priority[vec_no - 0x20] = priority;
+}
+
+/* Enables nested interrupts.  Called by the kernel command-line
+   option parser. */
+void
+intr_nest_configure(void)
+{
+    nest_enabled = true;
+}
+
+/* Registers external interrupt VEC_NO to invoke HANDLER, which
+   is named NAME for debugging purposes, in a kernel thread with
+   priority PRIORITY, if threaded interrupt handlers are enabled.
+   Otherwise, this is the same as intr_register_ext().  Either
+   way, the handler will execute with interrupts disabled.  In a
+   thread, it is passed a null pointer for its interrupt frame,
+   and it must not call intr_yield_on_return(). */
+void
+intr_register_threaded(uint8_t vec_no, int priority,
+    intr_handler_func *handler, const char *name)
+{
+    struct intr_thread *it = &intr_threads[vec_no - 0x20];
+
+    ASSERT(vec_no >= 0x20 && vec_no <= 0x2f);
+    ASSERT(priority >= PRI_MIN && priority <= PRI_MAX);
+
+    it->handler = handler;
+    it->priority = priority;
+    spinlock_init(&it->lock);
+    register_handler(vec_no, 0, INTR_OFF, threaded_interrupt, name);
+    if (threads_started)
+        start_intr_thread(vec_no);
+}
+
+/* Enables threaded interrupt handlers.  Called by the kernel
+   command-line option parser. */
+void
+intr_threads_configure(void)
+{
+    threads_configured = true;
+}
+
+/* Starts the threads for the handlers registered so far with
+   intr_register_threaded(), if threaded interrupt handlers are
+   enabled.  Handlers registered later get their threads right
+   away.  Must be called after thread_start(). */
+void
+intr_start_threads(void)
+{
+    int i;
+
+    threads_started = true;
+    for (i = 0; i < 0x10; i++)
+        if (intr_threads[i].handler != NULL)
+            start_intr_thread(0x20 + i);
+}
+
+/* Creates the thread for the handler registered for VEC_NO, if
+   threaded interrupt handlers are enabled. */
+static void
+start_intr_thread(uint8_t vec_no)
+{
+    struct intr_thread *it = &intr_threads[vec_no - 0x20];
+
+    if (!threads_configured)
+        return;
+    if (thread_create(intr_names[vec_no], it->priority, intr_thread_func,
+            it) == TID_ERROR)
+        printf("%s: cannot create interrupt thread, "
+            "handling interrupts directly\n", intr_names[vec_no]);
+}
+
+/* Interrupt handler for vectors registered with
+   intr_register_threaded().  Wakes the vector's thread, or runs
+   its handler directly if it has no thread. */
+static void
+threaded_interrupt(struct intr_frame *f)
+{
+    struct intr_thread *it = &intr_threads[f->vec_no - 0x20];
+    struct thread *woken = NULL;
+    enum intr_level old_level;
+    bool threaded;
+
+    old_level = intr_disable();
+    spinlock_acquire(&it->lock);
+    threaded = it->thread != NULL;
+    if (threaded) {
+        it->pending++;
+        if (it->waiting) {
+            it->waiting = false;
+            woken = it->thread;
+            thread_unblock(woken);
+        }
+    }
+    spinlock_release(&it->lock);
+    intr_set_level(old_level);
+
+    if (!threaded)
+        it->handler(f);
+    else if (woken != NULL && woken->priority > thread_get_priority())
+        intr_yield_on_return();
+}
+
+/* Body of the thread for a handler registered with
+   intr_register_threaded().  AUX is its struct intr_thread. */
+static void
+intr_thread_func(void *aux)
+{
+    struct intr_thread *it = aux;
+
+    intr_disable();
+    spinlock_acquire(&it->lock);
+    it->thread = thread_current();
+    spinlock_release(&it->lock);
+
+    for (;;) {
+        uint64_t start;
+
+        /* Wait for an interrupt. */
+        spinlock_acquire(&it->lock);
+        while (it->pending == 0) {
+            it->waiting = true;
+            thread_block_locked(&it->lock);
+            spinlock_acquire(&it->lock);
+        }
+        it->pending--;
+        spinlock_release(&it->lock);
+
+        start = tsc_read();
+        it->handler(NULL);
+        it->cycles += tsc_read() - start;
+        it->runs++;
+
+        /* Let other threads run, and interrupts arrive, between
+           requests. */
+        intr_enable();
+        intr_disable();
+    }
+}
+
 /* Registers internal interrupt VEC_NO to invoke HANDLER, which
    is named NAME for debugging purposes.  The interrupt handler
    will be invoked with interrupt status LEVEL.
@@ -211,7 +591,19 @@ intr_register_int(uint8_t vec_no, int dpl, enum intr_level level,
 bool
 intr_context(void)
 {
-    return in_external_intr;
+    uint32_t flags;
+    bool in_intr;
+
+    /* With interrupts on, the running thread could move to
+       another CPU between finding its CPU and checking it, so
+       turn them off for a moment.  This bypasses intr_disable()
+       to stay out of the interrupts-off profiler, which calls
+       us. */
+    asm volatile ("pushfl; popl %0; cli" : "=g" (flags) : : "memory");
+    in_intr = cpu_current()->intr_depth > 0;
+    if (flags & FLAG_IF)
+        asm volatile ("sti" : : : "memory");
+    return in_intr;
 }
 
 /* During processing of an external interrupt, directs the
@@ -222,7 +614,7 @@ void
 intr_yield_on_return(void)
 {
     ASSERT(intr_context());
-    yield_on_return = true;
+    cpu_current()->yield_on_return = true;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -274,6 +666,17 @@ pic_end_of_interrupt(int irq)
         outb(0xa0, 0x20);
 }
 
+/* Acknowledges external interrupt IRQ on whichever interrupt
+   controller delivered it. */
+static void
+end_of_interrupt(int irq)
+{
+    if (apic_enabled())
+        apic_eoi();
+    else
+        pic_end_of_interrupt(irq);
+}
+
 /* Creates an gate that invokes FUNCTION.
 
    The gate has descriptor privilege level DPL, meaning that it
@@ -345,23 +748,150 @@ void
 intr_handler(struct intr_frame *frame)
 {
     bool external;
-    intr_handler_func *handler;
+    struct cpu *c = cpu_current();
+
+    /* Entering an interrupt gate turned interrupts off.  If a
+       section was still open, interrupts were turned on behind
+       our back, so throw it away. */
+    if ((frame->eflags & FLAG_IF) && intr_get_level() == INTR_OFF
+        && c->id == 0) {
+        off_open = false;
+        off_begin(NULL, frame->vec_no);
+    }
 
     /* External interrupts are special.
-       We only handle one at a time (so interrupts must be off)
-       and they need to be acknowledged on the PIC (see below).
-       An external interrupt handler cannot sleep. */
+       Unless they nest, we only handle one at a time (so
+       interrupts must be off), and they need to be acknowledged
+       on the PIC or APIC (see below).  An external interrupt
+       handler cannot sleep. */
     external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
-    if (external) {
+    if (!external)
+        call_handler(frame);
+    else {
         ASSERT(intr_get_level() == INTR_OFF);
-        ASSERT(!intr_context());
+        ASSERT(c->intr_depth == 0 || c->intr_nestable);
+
+        if (c->intr_depth == 0)
+            c->yield_on_return = false;
+        handle_external(frame, c);
+
+        /* Yield once the outermost interrupt is done. */
+        if (c->intr_depth == 0 && c->yield_on_return) {
+            intr_stats[frame->vec_no].yield_cnt++;
+            thread_yield();
+        }
+    }
+
+    /* Returning from the interrupt will turn interrupts back on. */
+    if ((frame->eflags & FLAG_IF) && intr_get_level() == INTR_OFF)
+        off_end(NULL, frame->vec_no);
+}
+
+/* Handles external interrupt FRAME on CPU C, with interrupts
+   off, or defers it if C is already handling an interrupt of
+   equal or higher priority. */
+static void
+handle_external(struct intr_frame *frame, struct cpu *c)
+{
+    int irq = frame->vec_no - 0x20;
 
-        in_external_intr = true;
-        yield_on_return = false;
+    if (c->intr_depth > 0 && ext_priority[irq] <= c->intr_priority) {
+        c->intr_deferred |= 1 << irq;
+        defer_cnt++;
+        end_of_interrupt(frame->vec_no);
+        return;
     }
+    run_external(frame, c, false);
+}
+
+/* Runs the handler for external interrupt FRAME on CPU C, with
+   interrupts off, then any interrupts it deferred that outrank
+   the interrupt it preempted, if any.  ACKED is true if the
+   interrupt has already been acknowledged. */
+static void
+run_external(struct intr_frame *frame, struct cpu *c, bool acked)
+{
+    int irq = frame->vec_no - 0x20;
+    int priority = ext_priority[irq];
+    int prev_priority = c->intr_priority;
+    bool prev_nestable = c->intr_nestable;
+    size_t stack_free;
+    bool nest;
+
+    /* The frame is on the interrupted thread's kernel stack,
+       which runs down to the end of its struct thread. */
+    stack_free = (uint8_t *) frame
+        - ((uint8_t *) pg_round_down(frame) + sizeof (struct thread));
+
+    c->intr_depth++;
+    c->intr_priority = priority;
+    nest = nest_enabled && priority < INTR_PRI_MAX;
+    if (nest && (c->intr_depth > INTR_NEST_MAX
+            || stack_free < INTR_NEST_STACK_MIN)) {
+        nest = false;
+        refuse_cnt++;
+    }
+    if (c->intr_depth > nest_max_depth)
+        nest_max_depth = c->intr_depth;
+    if (stack_free < nest_min_free)
+        nest_min_free = stack_free;
+
+    if (nest) {
+        /* Acknowledge the interrupt first, so that the PIC or
+           APIC may deliver others while the handler runs. */
+        if (!acked)
+            end_of_interrupt(frame->vec_no);
+        acked = true;
+        nest_cnt++;
+
+        c->intr_nestable = true;
+        off_end(NULL, frame->vec_no);
+        asm volatile ("sti" : : : "memory");
+        call_handler(frame);
+        asm volatile ("cli" : : : "memory");
+        off_begin(NULL, frame->vec_no);
+    } else {
+        c->intr_nestable = false;
+        call_handler(frame);
+    }
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    c->intr_nestable = prev_nestable;
+    c->intr_priority = prev_priority;
+    c->intr_depth--;
+    if (!acked)
+        end_of_interrupt(frame->vec_no);
+
+    /* Run deferred interrupts, highest priority first, unless
+       the interrupt we preempted outranks them. */
+    while (c->intr_deferred != 0) {
+        struct intr_frame deferred = *frame;
+        int best = -1;
+        int i;
+
+        for (i = 0; i < 0x10; i++)
+            if ((c->intr_deferred & (1 << i))
+                && (best < 0 || ext_priority[i] > ext_priority[best]))
+                best = i;
+        if (c->intr_depth > 0 && ext_priority[best] <= c->intr_priority)
+            break;
+
+        c->intr_deferred &= ~(1 << best);
+        deferred.vec_no = 0x20 + best;
+        run_external(&deferred, c, true);
+    }
+}
 
-    /* Invoke the interrupt's handler. */
-    handler = intr_handlers[frame->vec_no];
+/* Invokes FRAME's interrupt handler and updates its
+   statistics. */
+static void
+call_handler(struct intr_frame *frame)
+{
+    intr_handler_func *handler = intr_handlers[frame->vec_no];
+    struct intr_stats *stats = &intr_stats[frame->vec_no];
+    uint64_t start, cycles;
+
+    start = tsc_read();
     if (handler != NULL)
         handler(frame);
     else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f) {
@@ -371,17 +901,11 @@ intr_handler(struct intr_frame *frame)
     } else
         unexpected_interrupt(frame);
 
-    /* Complete the processing of an external interrupt. */
-    if (external) {
-        ASSERT(intr_get_level() == INTR_OFF);
-        ASSERT(intr_context());
-
-        in_external_intr = false;
-        pic_end_of_interrupt(frame->vec_no);
-
-        if (yield_on_return)
-            thread_yield();
-    }
+    cycles = tsc_read() - start;
+    stats->cnt++;
+    stats->cycles += cycles;
+    if (cycles > stats->max_cycles)
+        stats->max_cycles = cycles;
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -426,6 +950,74 @@ intr_dump_frame(const struct intr_frame *f)
         f->cs, f->ds, f->es, f->ss);
 }
 
+/* Prints interrupt statistics: for each vector that has been
+   handled, the number of interrupts, the total, average and
+   maximum cycles spent in its handler, and how many times it
+   caused a yield on return; then, if enabled, the longest
+   sections with interrupts off. */
+void
+intr_print_stats(void)
+{
+    unsigned i;
+
+    for (i = 0; i < INTR_CNT; i++) {
+        enum intr_level old_level;
+        struct intr_stats s;
+
+        /* Take a consistent snapshot, since we may be printing
+           from a thread while interrupts keep arriving. */
+        old_level = intr_disable();
+        s = intr_stats[i];
+        intr_set_level(old_level);
+
+        if (s.cnt == 0)
+            continue;
+        printf("Interrupt %#04x (%s): %"PRIu64" calls, %"PRIu64" cycles, "
+            "%"PRIu64" avg, %"PRIu64" max, %"PRIu64" yields\n",
+            i, intr_names[i], s.cnt, s.cycles, s.cycles / s.cnt,
+            s.max_cycles, s.yield_cnt);
+    }
+
+    for (i = 0; i < 0x10; i++) {
+        const struct intr_thread *it = &intr_threads[i];
+
+        if (it->runs == 0)
+            continue;
+        printf("Interrupt thread %#04x (%s): %"PRIu64" runs, "
+            "%"PRIu64" cycles, %"PRIu64" avg, priority %d\n",
+            0x20 + i, intr_names[0x20 + i], it->runs, it->cycles,
+            it->cycles / it->runs, it->priority);
+    }
+
+    if (nest_cnt > 0 || defer_cnt > 0)
+        printf("Interrupt nesting: %u nested, %u deferred, %u refused, "
+            "max depth %u, min stack free %zu bytes\n", nest_cnt, defer_cnt,
+            refuse_cnt, nest_max_depth, nest_min_free);
+
+    if (off_keep == 0)
+        return;
+
+    printf("Interrupts off: %"PRIu64" sections, %"PRIu64" cycles, "
+        "%u longest:\n", off_cnt, off_cycles, off_kept);
+    for (i = 0; i < off_kept; i++) {
+        printf("Interrupts off: %"PRIu64" cycles from ", off_top[i].cycles);
+        print_off_site(&off_top[i].begin);
+        printf(" to ");
+        print_off_site(&off_top[i].end);
+        printf("\n");
+    }
+}
+
+/* Prints SITE for intr_print_stats(). */
+static void
+print_off_site(const struct off_site *site)
+{
+    if (site->pc != NULL)
+        printf("%p", site->pc);
+    else
+        printf("intr %#04x (%s)", site->vec, intr_names[site->vec]);
+}
+
 /* Returns the name of interrupt VEC. */
 const char *
 intr_name(uint8_t vec)
@@ -15,6 +15,11 @@ enum intr_level intr_set_level(enum intr_level);
 enum intr_level intr_enable(void);
 enum intr_level intr_disable(void);
 
+/* Interrupts-off latency profiling. */
+#define INTR_OFF_DEFAULT 8 /* Default # of sections to keep. */
+#define INTR_OFF_MAX 32 /* Maximum # of sections to keep. */
+void intr_off_configure(unsigned keep);
+
 /* Interrupt stack frame. */
 struct intr_frame {
     /* Pushed by intr_entry in intr-stubs.S.
@@ -56,7 +61,15 @@ struct intr_frame {
 typedef void intr_handler_func(struct intr_frame *);
 
 void intr_init(void);
+void intr_init_ap(void);
 void intr_register_ext(uint8_t vec, intr_handler_func *, const char *name);
+#define INTR_PRI_MAX 15 /* Priority of vectors that never nest. */
+void intr_set_priority(uint8_t vec, int priority);
+void intr_nest_configure(void);
+void intr_register_threaded(uint8_t vec, int priority, intr_handler_func *,
+    const char *name);
+void intr_threads_configure(void);
+void intr_start_threads(void);
 void intr_register_int(uint8_t vec, int dpl, enum intr_level,
         intr_handler_func *, const char *name);
 bool intr_context(void);
@@ -64,5 +77,6 @@ void intr_yield_on_return(void);
 
 void intr_dump_frame(const struct intr_frame *);
 const char *intr_name(uint8_t vec);
+void intr_print_stats(void);
 
 #endif /* threads/interrupt.h */
@@ -36,7 +36,18 @@
 
 #include "threads/interrupt.h"
 #include "threads/lock.h"
+#include "threads/spinlock.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+
+/*
+ * Protects every lock's holder and priority, and every thread's
+ * donated priority, donor locks and lock_waiting_on, which
+ * priority donation reads and writes across threads that may be
+ * running on other CPUs.  All zeros, as in BSS, is an unlocked
+ * spinlock, so it needs no initialization.
+ */
+static struct spinlock donation_lock;
 
 /*
  * Initializes LOCK.  A lock can be held by at most a single
@@ -77,10 +88,13 @@ lock.
 void trickle_priority_donation(struct thread *initial_thread,
                                int new_priority) {
   struct lock *lock_current = initial_thread->lock_waiting_on;
+  int depth = 1;
   while (lock_current != NULL) {
     struct thread *thread_current =
         lock_current->holder; // The lock to be given donation
     thread_current->priority = new_priority;
+    trace_event(TRACE_DONATE, depth++, new_priority, thread_current->tid,
+                thread_tid());
     lock_current = thread_current->lock_waiting_on;
   }
 }
@@ -107,6 +121,9 @@ void give_priority_donation(struct lock *lock) {
  * we need to sleep.
  */
 void lock_acquire(struct lock *lock) {
+  enum intr_level old_level;
+  bool donated = false;
+
   ASSERT(lock != NULL);
   ASSERT(!intr_context());
   ASSERT(!lock_held_by_current_thread(lock));
@@ -115,6 +132,8 @@ void lock_acquire(struct lock *lock) {
    * the current running thread's priority to the the holder before blocking,
    * demonstrated in https://www.youtube.com/watch?v=dQwiWcHqS_8 and in
    * https://www.youtube.com/watch?v=nVUQ4f1-roM */
+  old_level = intr_disable();
+  spinlock_acquire(&donation_lock);
   if (lock->holder == NULL) {
     /* Acquire the lock since its untaken */
   } else {
@@ -135,10 +154,20 @@ void lock_acquire(struct lock *lock) {
           lock_priority_gt, NULL);
     }
     holder->priority = thread_get_priority(); // Donation!
-    thread_preempt();
+    trace_event(TRACE_DONATE, 0, holder->priority, holder->tid, thread_tid());
+    donated = true;
   }
+  spinlock_release(&donation_lock);
+  intr_set_level(old_level);
+  if (donated)
+    thread_preempt();
   semaphore_down(&lock->semaphore);
+
+  old_level = intr_disable();
+  spinlock_acquire(&donation_lock);
   lock->holder = thread_current();
+  spinlock_release(&donation_lock);
+  intr_set_level(old_level);
   /*@e*/
 }
 
@@ -194,20 +223,33 @@ bool thread_update_donated_priority(void) {
  * handler.
  */
 void lock_release(struct lock *lock) {
+  enum intr_level old_level;
+  bool donated;
+
   ASSERT(lock != NULL);
   ASSERT(lock_held_by_current_thread(lock)); /* need to use this reseting */
+  old_level = intr_disable();
+  spinlock_acquire(&donation_lock);
   struct thread *prev = lock->holder;
   lock->holder = NULL;
+  spinlock_release(&donation_lock);
+  intr_set_level(old_level);
   semaphore_up(&lock->semaphore);
   /*@a*/
   /* If there are donor locks, then give up the donation */
-  if (!list_empty(&prev->priority_donor_locks)) {
+  old_level = intr_disable();
+  spinlock_acquire(&donation_lock);
+  donated = !list_empty(&prev->priority_donor_locks);
+  if (donated) {
     lock_remove_from_list(lock, &thread_current()->priority_donor_locks);
     thread_revoke_donated_priority(); // Thread loses donated priority and goes
                                       // back to base
     thread_update_donated_priority(); // Get new donation if donors still exist
-    thread_preempt();
   }
+  spinlock_release(&donation_lock);
+  intr_set_level(old_level);
+  if (donated)
+    thread_preempt();
   thread_preempt(); // Make sure the current_thread is reset
   /*@e*/
 }
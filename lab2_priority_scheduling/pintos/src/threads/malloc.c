@@ -41,7 +41,7 @@
 struct desc {
     size_t block_size; /* Size of each element in bytes. */
     size_t blocks_per_arena; /* Number of blocks in an arena. */
-    struct list free_list; /* List of free blocks. */
+    struct clist free_list; /* List of free blocks. */
     struct lock lock; /* Lock. */
 };
 
@@ -78,7 +78,7 @@ malloc_init(void)
         ASSERT(desc_cnt <= sizeof descs / sizeof *descs);
         d->block_size = block_size;
         d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-        list_init(&d->free_list);
+        clist_init(&d->free_list);
         lock_init(&d->lock);
     }
 }
@@ -120,7 +120,7 @@ malloc(size_t size)
     lock_acquire(&d->lock);
 
     /* If the free list is empty, create a new arena. */
-    if (list_empty(&d->free_list)) {
+    if (clist_empty(&d->free_list)) {
         size_t i;
 
         /* Allocate a page. */
@@ -136,12 +136,12 @@ malloc(size_t size)
         a->free_cnt = d->blocks_per_arena;
         for (i = 0; i < d->blocks_per_arena; i++) {
             struct block *b = arena_to_block(a, i);
-            list_push_back(&d->free_list, &b->free_elem);
+            clist_push_back(&d->free_list, &b->free_elem);
         }
     }
 
     /* Get a block from free list and return it. */
-    b = list_entry(list_pop_front(&d->free_list), struct block, free_elem);
+    b = list_entry(clist_pop_front(&d->free_list), struct block, free_elem);
     a = block_to_arena(b);
     a->free_cnt--;
     lock_release(&d->lock);
@@ -225,7 +225,7 @@ free(void *p)
             lock_acquire(&d->lock);
 
             /* Add block to free list. */
-            list_push_front(&d->free_list, &b->free_elem);
+            clist_push_front(&d->free_list, &b->free_elem);
 
             /* If the arena is now entirely unused, free it. */
             if (++a->free_cnt >= d->blocks_per_arena) {
@@ -234,7 +234,7 @@ free(void *p)
                 ASSERT(a->free_cnt == d->blocks_per_arena);
                 for (i = 0; i < d->blocks_per_arena; i++) {
                     struct block *b = arena_to_block(a, i);
-                    list_remove(&b->free_elem);
+                    clist_remove(&d->free_list, &b->free_elem);
                 }
                 palloc_free_page(a);
             }
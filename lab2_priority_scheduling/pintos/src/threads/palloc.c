@@ -147,6 +147,44 @@ palloc_free_page(void *page)
     palloc_free_multiple(page, 1);
 }
 
+/* Returns the number of free pages in the user pool if PAL_USER
+   is set in FLAGS, otherwise in the kernel pool. */
+size_t
+palloc_free_cnt(enum palloc_flags flags)
+{
+    struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+    size_t cnt;
+
+    lock_acquire(&pool->lock);
+    cnt = bitmap_count(pool->used_map, 0, bitmap_size(pool->used_map), false);
+    lock_release(&pool->lock);
+    return cnt;
+}
+
+/* Returns the largest PAGE_CNT for which palloc_get_multiple()
+   with the same FLAGS would currently succeed, that is, the
+   length of the longest run of free pages in the pool selected
+   by FLAGS. */
+size_t
+palloc_largest_free(enum palloc_flags flags)
+{
+    struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+    size_t page_cnt = bitmap_size(pool->used_map);
+    size_t largest = 0;
+    size_t run = 0;
+    size_t i;
+
+    lock_acquire(&pool->lock);
+    for (i = 0; i < page_cnt; i++) {
+        if (bitmap_test(pool->used_map, i))
+            run = 0;
+        else if (++run > largest)
+            largest = run;
+    }
+    lock_release(&pool->lock);
+    return largest;
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
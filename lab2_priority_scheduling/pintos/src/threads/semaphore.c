@@ -53,6 +53,7 @@ void semaphore_init(struct semaphore *sema, unsigned value) {
 
   sema->value = value;
   list_init(&sema->waiters);
+  spinlock_init(&sema->lock);
 }
 
 /*
@@ -69,13 +70,17 @@ void semaphore_down(struct semaphore *sema) {
   ASSERT(!intr_context());
 
   enum intr_level old_level = intr_disable();
+  spinlock_acquire(&sema->lock);
   while (sema->value == 0) { // Busy-wait sleep
     list_insert_ordered(&sema->waiters, &thread_current()->sharedelem,
                         thread_priority_gt, NULL);
-    thread_block(); /* Turn off the thread running this code. Upon reawaking,
-                    run loop again. */
+    /* Turn off the thread running this code. Upon reawaking, run loop
+       again. */
+    thread_block_locked(&sema->lock);
+    spinlock_acquire(&sema->lock);
   }
   sema->value--;
+  spinlock_release(&sema->lock);
   intr_set_level(old_level);
 }
 
@@ -91,6 +96,7 @@ void semaphore_up(struct semaphore *semaphore) {
   ASSERT(semaphore != NULL);
 
   old_level = intr_disable();
+  spinlock_acquire(&semaphore->lock);
   if (!list_empty(&semaphore->waiters)) {
     /*@a*/
     thread_unblock(list_entry(list_pop_front(&semaphore->waiters),
@@ -98,6 +104,7 @@ void semaphore_up(struct semaphore *semaphore) {
     /*@e*/
   }
   semaphore->value++;
+  spinlock_release(&semaphore->lock);
   thread_preempt(); // Since the unblocked thread might have a higher priority
                     // than the running thread
   intr_set_level(old_level);
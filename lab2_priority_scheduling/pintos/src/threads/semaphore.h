@@ -4,11 +4,14 @@
 #include <list.h>
 #include <stdbool.h>
 
+#include "threads/spinlock.h"
+
 /* Semaphore */
 struct semaphore {
   unsigned value;               // Current value
   struct list waiters;          // List of waiting threads
   struct list_elem condvarelem; // Condvar waiters list elem
+  struct spinlock lock;         // Protects value and waiters
 };
 
 void semaphore_init(struct semaphore *, unsigned value);
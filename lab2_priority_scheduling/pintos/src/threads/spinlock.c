@@ -0,0 +1,76 @@
+#include "threads/spinlock.h"
+
+#include <debug.h>
+#include <stddef.h>
+
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+
+/* Initializes LOCK as free. */
+void spinlock_init(struct spinlock *lock) {
+  ASSERT(lock != NULL);
+
+  lock->locked = 0;
+  lock->holder = NULL;
+}
+
+/* Atomically sets LOCK's flag and returns its previous value.
+   `xchg' with a memory operand is implicitly locked, and it is
+   also a full memory barrier, so nothing done while holding the
+   lock can be moved ahead of it.  See [IA32-v2b] "XCHG". */
+static inline int test_and_set(struct spinlock *lock) {
+  int old = 1;
+
+  asm volatile("xchgl %0, %1" : "+r"(old), "+m"(lock->locked) : : "memory");
+  return old;
+}
+
+/* Acquires LOCK, spinning until it is free.  Interrupts must be
+   off, and this CPU must not already hold LOCK. */
+void spinlock_acquire(struct spinlock *lock) {
+  ASSERT(lock != NULL);
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(!spinlock_held(lock));
+
+  while (test_and_set(lock) != 0) {
+    /* Spin reading rather than writing, so that waiting CPUs
+       don't fight over the cache line, and tell the CPU that
+       this is a spin loop with `pause'. */
+    while (lock->locked)
+      asm volatile("pause");
+  }
+  lock->holder = cpu_current();
+}
+
+/* Tries to acquire LOCK without spinning.  Returns true if
+   successful, false if another CPU holds it.  Interrupts must be
+   off. */
+bool spinlock_try_acquire(struct spinlock *lock) {
+  ASSERT(lock != NULL);
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(!spinlock_held(lock));
+
+  if (test_and_set(lock) != 0)
+    return false;
+  lock->holder = cpu_current();
+  return true;
+}
+
+/* Releases LOCK, which this CPU must hold. */
+void spinlock_release(struct spinlock *lock) {
+  ASSERT(lock != NULL);
+  ASSERT(spinlock_held(lock));
+
+  lock->holder = NULL;
+
+  /* On x86, an ordinary store is not reordered with the loads
+     and stores before it, so only the compiler needs a
+     barrier. */
+  asm volatile("movl $0, %0" : "=m"(lock->locked) : : "memory");
+}
+
+/* Returns true if this CPU holds LOCK.  Interrupts must be
+   off. */
+bool spinlock_held(const struct spinlock *lock) {
+  return lock->locked && lock->holder == cpu_current();
+}
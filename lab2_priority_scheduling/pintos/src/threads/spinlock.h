@@ -0,0 +1,30 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <stdbool.h>
+
+/* Spinlock.
+
+   With one CPU, turning interrupts off is enough to keep other
+   code from running, but with several CPUs, code on the others
+   keeps running.  A spinlock makes them wait, by spinning, for
+   the holder to release it.
+
+   A spinlock may only be acquired and held with interrupts off,
+   so that an interrupt handler on the same CPU cannot try to
+   acquire it too, and its holder must not sleep, because threads
+   that want it would spin until the holder was scheduled again.
+   Use a lock or semaphore to protect anything that may be held
+   for long or across a sleep. */
+struct spinlock {
+  volatile int locked; /* 1 if held, 0 if free. */
+  struct cpu *holder;  /* CPU holding the lock (for debugging). */
+};
+
+void spinlock_init(struct spinlock *);
+void spinlock_acquire(struct spinlock *);
+bool spinlock_try_acquire(struct spinlock *);
+void spinlock_release(struct spinlock *);
+bool spinlock_held(const struct spinlock *);
+
+#endif /* threads/spinlock.h */
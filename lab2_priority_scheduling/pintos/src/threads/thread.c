@@ -32,20 +32,26 @@
  */
 
 #include <debug.h>
+#include <inttypes.h>
 #include <random.h>
+#include <stats.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "threads/condvar.h"
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/lock.h"
 #include "threads/palloc.h"
 #include "threads/semaphore.h"
+#include "threads/spinlock.h"
 #include "threads/switch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/tsc.h"
 #include "threads/vaddr.h"
 
 #ifdef USERPROG
@@ -57,16 +63,31 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running, are kept in the ready
+   list of a CPU, in struct cpu, protected by that CPU's
+   ready_lock.  Each ready list is counted, so that its length is
+   cheap to query.  Each CPU also has its own idle thread.
+
+   A thread is put on the ready list of the CPU that makes it
+   ready, and usually runs there, but a CPU whose ready list is
+   empty steals the highest priority thread from another CPU's
+   ready list.  A CPU never holds more than one ready_lock at a
+   time.
+
+   A thread that has just blocked or yielded is still running for
+   a moment, on the CPU that is switching away from it, and its
+   `on_cpu' member stays true until that switch is complete.  No
+   other CPU may run it until then, so thread_unblock() waits for
+   the switch to finish before making a thread ready, and a CPU
+   does not steal a thread that yielded until then. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* Idle thread. */
-static struct thread *idle_thread;
+/* Protects all_list and exited thread accounting. */
+static struct spinlock all_lock;
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -85,10 +106,40 @@ struct kernel_thread_frame {
 static long long idle_ticks;   /* # of timer ticks spent idle. */
 static long long kernel_ticks; /* # of timer ticks in kernel threads. */
 static long long user_ticks;   /* # of timer ticks in user programs. */
+static struct thread_acct exited_acct; /* Sum over exited threads. */
+static unsigned exited_cnt;            /* # of exited threads. */
+
+/* Wakeup-to-run latency histogram, per priority.  Bucket B
+   counts wakeups that waited fewer than 2**(B + LATENCY_MIN_LOG2 + 1)
+   cycles on the ready list, except that the last bucket also
+   counts all longer waits. */
+#define LATENCY_MIN_LOG2 10
+#define LATENCY_BUCKETS 24
+static unsigned wake_latency[PRI_MAX + 1][LATENCY_BUCKETS];
+
+/* Rows of the CPU accounting table, copied out of all_list by
+   print_all_acct().  Static because statistics are printed on
+   the way to powering off after a kernel panic, possibly in an
+   interrupt handler, where nothing can be allocated. */
+#define ACCT_ROWS_MAX 64
+struct acct_row {
+  tid_t tid;
+  char name[16];
+  struct thread_acct acct;
+};
+static struct acct_row acct_rows[ACCT_ROWS_MAX];
+
+/* Times print_all_acct() tries to take all_lock before it gives
+   up and copies the rows without it. */
+#define ACCT_LOCK_TRIES 1000000
+
+static int64_t ready_gauge(void);
+STAT_COUNTER(switch_stat, "thread.switches");
+STAT_GAUGE_FUNC(ready_stat, "thread.ready", ready_gauge);
+STAT_HISTOGRAM(wake_stat, "thread.wake_cycles");
 
 /* Scheduling. */
-#define TIME_SLICE 4          /* # of timer ticks to give each thread. */
-static unsigned thread_ticks; /* # of timer ticks since last yield. */
+#define TIME_SLICE 4 /* # of timer ticks to give each thread. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
@@ -98,13 +149,20 @@ bool thread_mlfqs;
 static void kernel_thread(thread_func *, void *aux);
 
 static void idle(void *aux UNUSED);
+static void idle_loop(void) NO_RETURN;
 static struct thread *running_thread(void);
-static struct thread *next_thread_to_run(void);
+static struct thread *next_thread_to_run(struct cpu *);
+static void init_cpu(struct cpu *);
+static void ready_insert(struct cpu *, struct thread *);
 static void init_thread(struct thread *, const char *name, int priority);
 static bool is_thread(struct thread *) UNUSED;
 static void *alloc_frame(struct thread *, size_t size);
 static void schedule(void);
+static enum trace_reason switch_reason(struct thread *);
 void thread_schedule_tail(struct thread *prev);
+static void print_acct(tid_t, const char *name, const struct thread_acct *);
+static void print_all_acct(void);
+static void record_wake_latency(struct thread *, uint64_t cycles);
 static tid_t allocate_tid(void);
 
 /* Initializes the threading system by transforming the code
@@ -124,16 +182,25 @@ void thread_init(void) {
   ASSERT(intr_get_level() == INTR_OFF);
 
   lock_init(&tid_lock);
-  list_init(&ready_list);
   list_init(&all_list);
+  spinlock_init(&all_lock);
+  init_cpu(&cpus[0]);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread();
   init_thread(initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
+  initial_thread->cpu = &cpus[0];
+  initial_thread->on_cpu = true;
   initial_thread->tid = allocate_tid();
 }
 
+/* Initializes the scheduler state of CPU C. */
+static void init_cpu(struct cpu *c) {
+  spinlock_init(&c->ready_lock);
+  clist_init(&c->ready_list);
+}
+
 /* Starts preemptive thread scheduling by enabling interrupts.
    Also creates the idle thread. */
 void thread_start(void) {
@@ -143,6 +210,7 @@ void thread_start(void) {
   tid_t t = thread_create("idle", PRI_DEFAULT, idle, &idle_started);
 
   /* Start preemptive thread scheduling. */
+  cpus[0].started = true;
   intr_enable();
 
   /*@a*/
@@ -157,9 +225,10 @@ void thread_start(void) {
    Thus, this function runs in an external interrupt context. */
 void thread_tick(void) {
   struct thread *t = thread_current();
+  struct cpu *c = cpu_current();
 
   /* Update statistics. */
-  if (t == idle_thread)
+  if (t == c->idle_thread)
     idle_ticks++;
 #ifdef USERPROG
   else if (t->pagedir != NULL)
@@ -169,16 +238,142 @@ void thread_tick(void) {
     kernel_ticks++;
 
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  if (++c->thread_ticks >= TIME_SLICE)
     intr_yield_on_return();
 }
 
-/* Prints thread statistics. */
+/* Prints thread statistics: global tick counts, then CPU
+   accounting for each live thread and for exited threads as a
+   whole, then the wakeup latency histogram of each priority that
+   saw any wakeups. */
 void thread_print_stats(void) {
+  enum intr_level old_level;
+  int pri;
+
   printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
          idle_ticks, kernel_ticks, user_ticks);
+
+  print_all_acct();
+
+  old_level = intr_disable();
+
+  for (pri = PRI_MIN; pri <= PRI_MAX; pri++) {
+    unsigned *bucket = wake_latency[pri];
+    int b, last;
+
+    for (last = LATENCY_BUCKETS - 1; last >= 0; last--)
+      if (bucket[last] != 0)
+        break;
+    if (last < 0)
+      continue;
+
+    printf("Thread: priority %d wakeup latency cycles:", pri);
+    for (b = 0; b <= last; b++)
+      if (b < LATENCY_BUCKETS - 1)
+        printf(" <2^%d:%u", b + LATENCY_MIN_LOG2 + 1, bucket[b]);
+      else
+        printf(" >=2^%d:%u", b + LATENCY_MIN_LOG2, bucket[b]);
+    printf("\n");
+  }
+  intr_set_level(old_level);
+}
+
+/* Prints ACCT as a row of the table printed by
+   thread_print_stats(), labeled with TID, or "-" if TID is
+   TID_ERROR, and NAME. */
+static void print_acct(tid_t tid, const char *name,
+                       const struct thread_acct *acct) {
+  char id[12];
+
+  if (tid != TID_ERROR)
+    snprintf(id, sizeof id, "%d", tid);
+  else
+    strlcpy(id, "-", sizeof id);
+  printf("Thread: %5s %-16s %15" PRIu64 " %15" PRIu64 " %15" PRIu64
+         " %8u %8u\n",
+         id, name, acct->run_cycles, acct->ready_cycles, acct->blocked_cycles,
+         acct->voluntary, acct->involuntary);
+}
+
+/* Prints the CPU accounting of each live thread, then of exited
+   threads as a whole.  The rows are copied out of all_list first
+   so that all_lock is not held across printf(), which is slow
+   and, except after a kernel panic, takes the console lock,
+   which may sleep.  Only the first ACCT_ROWS_MAX threads get
+   rows of their own. */
+static void print_all_acct(void) {
+  struct thread_acct exited;
+  unsigned exited_threads;
+  char exited_name[24];
+  struct list_elem *e;
+  enum intr_level old_level;
+  size_t cnt, omitted, i;
+  bool locked;
+  long tries;
+
+  old_level = intr_disable();
+
+  /* After a kernel panic, this CPU, or one that will never
+     release it, may hold all_lock.  Rather than panic again or
+     spin forever, give up on the lock after a while and copy
+     what we can without it. */
+  locked = false;
+  for (tries = 0; !locked && tries < ACCT_LOCK_TRIES; tries++) {
+    if (spinlock_held(&all_lock))
+      break;
+    locked = spinlock_try_acquire(&all_lock);
+    if (!locked)
+      asm volatile("pause");
+  }
+
+  /* Without the lock, all_list may be in the middle of a change,
+     so don't follow it any further than necessary. */
+  cnt = omitted = 0;
+  for (e = list_begin(&all_list);
+       e != list_end(&all_list) && (locked || cnt < ACCT_ROWS_MAX);
+       e = list_next(e)) {
+    struct thread *t = list_entry(e, struct thread, allelem);
+    if (cnt < ACCT_ROWS_MAX) {
+      acct_rows[cnt].tid = t->tid;
+      strlcpy(acct_rows[cnt].name, t->name, sizeof acct_rows[cnt].name);
+      acct_rows[cnt].acct = t->acct;
+      cnt++;
+    } else
+      omitted++;
+  }
+  exited_threads = exited_cnt;
+  exited = exited_acct;
+  if (locked)
+    spinlock_release(&all_lock);
+  intr_set_level(old_level);
+
+  printf("Thread: %5s %-16s %15s %15s %15s %8s %8s\n", "tid", "name",
+         "run cycles", "ready cycles", "blocked cycles", "vol", "invol");
+  if (!locked)
+    printf("Thread: (thread list busy, rows may be inconsistent)\n");
+  for (i = 0; i < cnt; i++)
+    print_acct(acct_rows[i].tid, acct_rows[i].name, &acct_rows[i].acct);
+  if (omitted > 0)
+    printf("Thread: (%zu more threads not shown)\n", omitted);
+  if (exited_threads > 0) {
+    snprintf(exited_name, sizeof exited_name, "(%u exited)", exited_threads);
+    print_acct(TID_ERROR, exited_name, &exited);
+  }
+}
+
+/* Returns the number of threads on the ready lists of all CPUs. */
+size_t thread_ready_count(void) {
+  size_t cnt = 0;
+  unsigned i;
+
+  for (i = 0; i < cpu_count(); i++)
+    cnt += clist_size(&cpus[i].ready_list);
+  return cnt;
 }
 
+/* Reads the "thread.ready" statistic. */
+static int64_t ready_gauge(void) { return thread_ready_count(); }
+
 /* Creates a new kernel thread named NAME with the given initial
    PRIORITY, which executes FUNCTION passing AUX as the argument,
    and adds it to the ready queue.  Returns the thread identifier
@@ -213,6 +408,7 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
   /* Initialize thread. */
   init_thread(t, name, priority);
   tid = t->tid = allocate_tid();
+  trace_thread(t);
 
   /* Prepare thread for first run by initializing its stack.
      Do this atomically so intermediate values for the 'stack'
@@ -263,6 +459,23 @@ void thread_block(void) {
   schedule();
 }
 
+/*
+ * Like thread_block(), but also releases LOCK, which the caller
+ * holds, once the thread is marked as blocked.  With more than one
+ * CPU, turning interrupts off does not keep another CPU from
+ * calling thread_unblock() on this thread, so whatever list the
+ * caller put the thread on so that it may be woken must be
+ * protected by LOCK.  LOCK is not reacquired on wakeup.
+ */
+void thread_block_locked(struct spinlock *lock) {
+  ASSERT(!intr_context());
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  thread_current()->status = THREAD_BLOCKED;
+  spinlock_release(lock);
+  schedule();
+}
+
 /*@a*/
 /* Comparison operator for thread priority */
 bool thread_priority_gt(const struct list_elem *a, const struct list_elem *b) {
@@ -284,34 +497,80 @@ bool thread_priority_gt(const struct list_elem *a, const struct list_elem *b) {
    update other data. */
 void thread_unblock(struct thread *t) {
   enum intr_level old_level;
+  struct cpu *c;
+  uint64_t now;
+  unsigned i;
 
   ASSERT(is_thread(t));
 
   old_level = intr_disable();
   ASSERT(t->status == THREAD_BLOCKED);
 
+  /* T may have blocked on another CPU that is still switching
+     away from it. */
+  while (t->on_cpu)
+    asm volatile("pause" : : : "memory");
+
+  now = tsc_read();
+  t->acct.blocked_cycles += now - t->state_since;
+  t->state_since = now;
+  t->woken = true;
+
   /*@a Let's sort the ready_list here here */
-  list_insert_ordered(&ready_list, &t->sharedelem, thread_priority_gt, NULL);
+  c = cpu_current();
+  t->status = THREAD_READY;
+  ready_insert(c, t);
   /*@e*/
 
   // list_push_back(&ready_list, &t->sharedelem);
-  t->status = THREAD_READY;
+  trace_event(TRACE_UNBLOCK, 0, t->priority, t->tid, running_thread()->tid);
+
+  /* Wake up an idle CPU to steal T, if there is one. */
+  for (i = 0; i < cpu_count(); i++)
+    if (cpus[i].idling && &cpus[i] != c) {
+      cpu_kick(&cpus[i]);
+      break;
+    }
   intr_set_level(old_level);
 }
 
+/* Inserts T, which must be ready, into C's ready list in priority
+   order. */
+static void ready_insert(struct cpu *c, struct thread *t) {
+  ASSERT(t->status == THREAD_READY);
+
+  spinlock_acquire(&c->ready_lock);
+  clist_insert_ordered(&c->ready_list, &t->sharedelem, thread_priority_gt,
+                       NULL);
+  spinlock_release(&c->ready_lock);
+}
+
 /*@a
  * Check if the running thread has the highest priority. If not, have it yield
- * the CPU. */
+ * the CPU, or in an interrupt handler, yield when the interrupt returns. */
 void thread_preempt(void) {
-  if (!list_empty(&ready_list)) {
+  enum intr_level old_level = intr_disable();
+  struct cpu *c = cpu_current();
+  bool yield = false;
+
+  spinlock_acquire(&c->ready_lock);
+  if (!clist_empty(&c->ready_list)) {
     /* Because of the ordered insert, the first element will be the highest
      * priority thread */
     struct thread *highest_priority_thread =
-        list_entry(list_front(&ready_list), struct thread, sharedelem);
-    if (thread_get_priority() <= highest_priority_thread->priority) {
+        list_entry(clist_front(&c->ready_list), struct thread, sharedelem);
+    yield = thread_get_priority() <= highest_priority_thread->priority;
+  }
+  spinlock_release(&c->ready_lock);
+
+  if (yield) {
+    c->preempting = true;
+    if (intr_context())
+      intr_yield_on_return();
+    else
       thread_yield();
-    }
   }
+  intr_set_level(old_level);
 }
 /*@e*/
 
@@ -351,7 +610,9 @@ void thread_exit(void) {
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable();
+  spinlock_acquire(&all_lock);
   list_remove(&thread_current()->allelem);
+  spinlock_release(&all_lock);
   thread_current()->status = THREAD_DYING;
   schedule();
   NOT_REACHED();
@@ -366,26 +627,27 @@ void thread_yield(void) {
   ASSERT(!intr_context());
 
   old_level = intr_disable();
-  if (cur != idle_thread) {
-    list_insert_ordered(&ready_list, &cur->sharedelem, thread_priority_gt,
-                        NULL);
-  }
   cur->status = THREAD_READY;
+  if (cur != cpu_current()->idle_thread)
+    ready_insert(cpu_current(), cur);
   schedule();
   intr_set_level(old_level);
 }
 
 /* Invoke function 'func' on all threads, passing along 'aux'.
-   This function must be called with interrupts off. */
+   This function must be called with interrupts off.  'func' must
+   not sleep, because it runs with all_lock held. */
 void thread_foreach(thread_action_func *func, void *aux) {
   struct list_elem *e;
 
   ASSERT(intr_get_level() == INTR_OFF);
 
+  spinlock_acquire(&all_lock);
   for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e)) {
     struct thread *t = list_entry(e, struct thread, allelem);
     func(t, aux);
   }
+  spinlock_release(&all_lock);
 }
 
 /* Sets the current thread's priority to NEW_PRIORITY. */
@@ -427,22 +689,35 @@ int thread_get_recent_cpu(void) {
 
 /* Idle thread.  Executes when no other thread is ready to run.
 
-   The idle thread is initially put on the ready list by
-   thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   The boot processor's idle thread is initially put on the
+   ready list by thread_start().  It will be scheduled once
+   initially, at which point it becomes the CPU's idle_thread,
+   "up"s the semaphore passed to it to enable thread_start() to
+   continue, and immediately blocks.  After that, the idle thread
+   never appears in a ready list.  It is returned by
+   next_thread_to_run() as a special case when there is no thread
+   to run.  Each other CPU starts out running its idle thread; see
+   thread_start_ap(). */
 static void idle(void *idle_started_ UNUSED) {
   struct semaphore *idle_started = idle_started_;
-  idle_thread = thread_current();
+  enum intr_level old_level = intr_disable();
+  cpu_current()->idle_thread = thread_current();
+  intr_set_level(old_level);
   semaphore_up(idle_started);
 
+  idle_loop();
+}
+
+/* The idle thread's main loop. */
+static void idle_loop(void) {
   for (;;) {
+    struct cpu *c;
+
     /* Let someone else run. */
     intr_disable();
     thread_block();
+    c = cpu_current();
+    c->idling = true;
 
     /* Re-enable interrupts and wait for the next one.
 
@@ -457,9 +732,54 @@ static void idle(void *idle_started_ UNUSED) {
        See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
        7.11.1 "HLT Instruction". */
     asm volatile("sti; hlt" : : : "memory");
+    c->idling = false;
   }
 }
 
+/* Creates the idle thread for CPU C, which is not yet running,
+   and sets up C's scheduler state.  C will start out running the
+   idle thread on its stack, calling thread_start_ap() once it is
+   ready to schedule threads.  Returns the idle thread, or a null
+   pointer if memory is exhausted. */
+struct thread *thread_create_idle(struct cpu *c) {
+  struct thread *t;
+  char name[16];
+
+  t = palloc_get_page(PAL_ZERO);
+  if (t == NULL)
+    return NULL;
+
+  snprintf(name, sizeof name, "idle%u", c->id);
+  init_thread(t, name, PRI_DEFAULT);
+  t->tid = allocate_tid();
+  t->status = THREAD_RUNNING;
+  t->cpu = c;
+  t->on_cpu = true;
+  trace_thread(t);
+
+  init_cpu(c);
+  c->idle_thread = t;
+  return t;
+}
+
+/* Frees the idle thread that thread_create_idle() created for
+   CPU C, which never ran it. */
+void thread_destroy_idle(struct cpu *c) {
+  palloc_free_page(c->idle_thread);
+  c->idle_thread = NULL;
+}
+
+/* Joins the scheduler on an application processor, running its
+   idle thread, which must be the running thread.  Called with
+   interrupts off.  Never returns. */
+void thread_start_ap(void) {
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(running_thread() == cpu_current()->idle_thread);
+
+  intr_enable();
+  idle_loop();
+}
+
 /* Function used as the basis for a kernel thread. */
 static void kernel_thread(thread_func *function, void *aux) {
   ASSERT(function != NULL);
@@ -489,6 +809,8 @@ static bool is_thread(struct thread *t) {
 /* Does basic initialization of T as a blocked thread named
    NAME. */
 static void init_thread(struct thread *t, const char *name, int priority) {
+  enum intr_level old_level;
+
   ASSERT(t != NULL);
   ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT(name != NULL);
@@ -498,13 +820,19 @@ static void init_thread(struct thread *t, const char *name, int priority) {
   strlcpy(t->name, name, sizeof t->name);
   t->stack = (uint8_t *)t + PGSIZE;
   t->priority = priority;
+  t->state_since = tsc_read();
   /*@a*/
   t->base_priority = priority;
   t->lock_waiting_on = NULL;
   list_init(&t->priority_donor_locks);
   /*@e*/
   t->magic = THREAD_MAGIC;
+
+  old_level = intr_disable();
+  spinlock_acquire(&all_lock);
   list_push_back(&all_list, &t->allelem);
+  spinlock_release(&all_lock);
+  intr_set_level(old_level);
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -518,16 +846,82 @@ static void *alloc_frame(struct thread *t, size_t size) {
   return t->stack;
 }
 
-/* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
-static struct thread *next_thread_to_run(void) {
-  if (list_empty(&ready_list))
-    return idle_thread;
-  else
-    return list_entry(list_pop_front(&ready_list), struct thread, sharedelem);
+/* Removes and returns the highest priority thread in C's ready
+   list, or returns a null pointer if it is empty. */
+static struct thread *ready_pop(struct cpu *c) {
+  struct thread *t = NULL;
+
+  spinlock_acquire(&c->ready_lock);
+  if (!clist_empty(&c->ready_list))
+    t = list_entry(clist_pop_front(&c->ready_list), struct thread, sharedelem);
+  spinlock_release(&c->ready_lock);
+  return t;
+}
+
+/* Returns the highest priority thread in C's ready list that
+   another CPU may steal, or a null pointer if there is none.  C's
+   ready_lock must be held. */
+static struct thread *stealable(struct cpu *c) {
+  struct thread *t;
+
+  if (clist_empty(&c->ready_list))
+    return NULL;
+  t = list_entry(clist_front(&c->ready_list), struct thread, sharedelem);
+  return t->on_cpu ? NULL : t;
+}
+
+/* Steals a thread for C to run from the ready list of another
+   CPU, the one whose first thread has the highest priority.
+   Returns the thread, or a null pointer if no other CPU has a
+   thread to steal. */
+static struct thread *steal_thread(struct cpu *c) {
+  struct cpu *victim = NULL;
+  int victim_pri = PRI_MIN - 1;
+  struct thread *t;
+  unsigned i;
+
+  /* Pick a victim, skipping empty ready lists without locking
+     them.  The victim's ready list may change before we lock it
+     again, so we may come away empty-handed, in which case we try
+     again on the next tick or kick. */
+  for (i = 0; i < cpu_count(); i++) {
+    struct cpu *v = &cpus[i];
+
+    if (v != c && !clist_empty(&v->ready_list)) {
+      spinlock_acquire(&v->ready_lock);
+      t = stealable(v);
+      if (t != NULL && t->priority > victim_pri) {
+        victim = v;
+        victim_pri = t->priority;
+      }
+      spinlock_release(&v->ready_lock);
+    }
+  }
+  if (victim == NULL)
+    return NULL;
+
+  spinlock_acquire(&victim->ready_lock);
+  t = stealable(victim);
+  if (t != NULL) {
+    clist_pop_front(&victim->ready_list);
+    c->steals++;
+  }
+  spinlock_release(&victim->ready_lock);
+  return t;
+}
+
+/* Chooses and returns the next thread for CPU C to run.  Should
+   return a thread from C's ready list, unless it is empty.  (If
+   the running thread can continue running, then it will be in
+   the ready list.)  If C's ready list is empty, steal a thread
+   from another CPU, and if there is none, return C's idle
+   thread. */
+static struct thread *next_thread_to_run(struct cpu *c) {
+  struct thread *t = ready_pop(c);
+
+  if (t == NULL && cpu_count() > 1)
+    t = steal_thread(c);
+  return t != NULL ? t : c->idle_thread;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -549,14 +943,21 @@ static struct thread *next_thread_to_run(void) {
  */
 void thread_schedule_tail(struct thread *prev) {
   struct thread *cur = running_thread();
+  uint64_t now = tsc_read();
 
   ASSERT(intr_get_level() == INTR_OFF);
 
   /* Mark us as running. */
   cur->status = THREAD_RUNNING;
+  cur->acct.ready_cycles += now - cur->state_since;
+  if (cur->woken) {
+    record_wake_latency(cur, now - cur->state_since);
+    cur->woken = false;
+  }
+  cur->state_since = now;
 
   /* Start new time slice. */
-  thread_ticks = 0;
+  cur->cpu->thread_ticks = 0;
 
 #ifdef USERPROG
   /* Activate the new address space. */
@@ -568,10 +969,42 @@ void thread_schedule_tail(struct thread *prev) {
      pull out the rug under itself.  (We don't free
      initial_thread because its memory was not obtained via
      palloc().) */
-  if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) {
-    ASSERT(prev != cur);
-    palloc_free_page(prev);
+  if (prev != NULL) {
+    bool dying = prev->status == THREAD_DYING;
+
+    if (dying) {
+      spinlock_acquire(&all_lock);
+      exited_acct.run_cycles += prev->acct.run_cycles;
+      exited_acct.ready_cycles += prev->acct.ready_cycles;
+      exited_acct.blocked_cycles += prev->acct.blocked_cycles;
+      exited_acct.voluntary += prev->acct.voluntary;
+      exited_acct.involuntary += prev->acct.involuntary;
+      exited_cnt++;
+      spinlock_release(&all_lock);
+      if (prev != initial_thread) {
+        ASSERT(prev != cur);
+        palloc_free_page(prev);
+      }
+    } else {
+      /* PREV may now run on another CPU, which may free it, so
+         this must be our last access to it. */
+      prev->on_cpu = false;
+    }
+  }
+}
+
+/* Adds a wakeup of T that waited CYCLES on the ready list to the
+   latency histogram for T's priority. */
+static void record_wake_latency(struct thread *t, uint64_t cycles) {
+  int b = 0;
+
+  stat_hist_add(&wake_stat, cycles);
+  cycles >>= LATENCY_MIN_LOG2 + 1;
+  while (cycles != 0 && b < LATENCY_BUCKETS - 1) {
+    cycles >>= 1;
+    b++;
   }
+  wake_latency[t->priority][b]++;
 }
 
 /* Schedules a new process.  At entry, interrupts must be off and
@@ -584,18 +1017,51 @@ void thread_schedule_tail(struct thread *prev) {
  */
 static void schedule(void) {
   struct thread *cur = running_thread();
-  struct thread *next = next_thread_to_run();
+  struct cpu *c = cur->cpu;
+  struct thread *next = next_thread_to_run(c);
   struct thread *prev = NULL;
+  enum trace_reason reason = switch_reason(cur);
+  uint64_t now;
 
   ASSERT(intr_get_level() == INTR_OFF);
   ASSERT(cur->status != THREAD_RUNNING);
   ASSERT(is_thread(next));
 
-  if (cur != next)
+  ASSERT(next == cur || !next->on_cpu);
+  next->cpu = c;
+  next->on_cpu = true;
+
+  now = tsc_read();
+  trace_event(TRACE_SWITCH, reason, next->priority, cur->tid, next->tid);
+  c->preempting = false;
+
+  cur->acct.run_cycles += now - cur->state_since;
+  cur->state_since = now;
+
+  if (cur != next) {
+    if (reason == TRACE_PREEMPT)
+      cur->acct.involuntary++;
+    else
+      cur->acct.voluntary++;
+    stat_inc(&switch_stat);
     prev = switch_threads(cur, next);
+  }
   thread_schedule_tail(prev);
 }
 
+/* Returns why CUR, whose status has just been changed from
+   THREAD_RUNNING, is giving up the CPU. */
+static enum trace_reason switch_reason(struct thread *cur) {
+  if (cur->status == THREAD_BLOCKED)
+    return TRACE_BLOCK;
+  else if (cur->status == THREAD_DYING)
+    return TRACE_EXIT;
+  else if (cur->cpu->preempting || cur->cpu->thread_ticks >= TIME_SLICE)
+    return TRACE_PREEMPT;
+  else
+    return TRACE_YIELD;
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t allocate_tid(void) {
   static tid_t next_tid = 1;
@@ -3,8 +3,18 @@
 
 #include <debug.h>
 #include <list.h>
+#include <stdbool.h>
 #include <stdint.h>
 
+/* Per-thread CPU accounting, in time-stamp counter cycles. */
+struct thread_acct {
+  uint64_t run_cycles;     /* Time spent running. */
+  uint64_t ready_cycles;   /* Time spent ready but not running. */
+  uint64_t blocked_cycles; /* Time spent blocked. */
+  unsigned voluntary;      /* Switches away by blocking or yielding. */
+  unsigned involuntary;    /* Switches away by preemption. */
+};
+
 /* States in a thread's life cycle. */
 enum thread_status {
   THREAD_RUNNING, /* Running thread. */
@@ -100,6 +110,13 @@ struct thread {
   int sleep_till;                   // Time frame to sleep till
   /*@e*/
 
+  // Owned by thread.c
+  struct thread_acct acct; // CPU accounting
+  uint64_t state_since;    // Time-stamp counter at last status change
+  bool woken;              // Readied by thread_unblock() since last run?
+  struct cpu *cpu;         // CPU that runs or last ran this thread
+  volatile bool on_cpu;    // Still running on CPU, perhaps switching away?
+
   // Change nothing and add nothing below this line
 #ifdef USERPROG
   // Owned by userprog/process.c
@@ -119,17 +136,25 @@ extern bool thread_mlfqs;
 bool thread_priority_gt(const struct list_elem *a, const struct list_elem *b);
 /*@e*/
 
+struct cpu;
+struct spinlock;
+
 void thread_init(void);
 void thread_start(void);
+struct thread *thread_create_idle(struct cpu *);
+void thread_destroy_idle(struct cpu *);
+void thread_start_ap(void) NO_RETURN;
 
 void thread_tick(void);
 void thread_print_stats(void);
+size_t thread_ready_count(void);
 
 typedef void thread_func(void *aux);
 tid_t thread_create(const char *name, int priority, thread_func *, void *);
 
 void thread_preempt(void);
 void thread_block(void);
+void thread_block_locked(struct spinlock *);
 void thread_unblock(struct thread *);
 
 struct thread *thread_current(void);
@@ -0,0 +1,185 @@
+#include "threads/trace.h"
+
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/spinlock.h"
+#include "threads/tsc.h"
+#include "threads/vaddr.h"
+
+/* Scheduler event tracing.
+
+   Events are appended to a ring buffer allocated by
+   trace_init(), overwriting the oldest once it fills, so the
+   dump always holds the most recent history.  Thread names go
+   into a separate, smaller ring, written once per thread rather
+   than once per event.
+
+   The dump printed by trace_print_stats() looks like this:
+
+     Trace: begin 20-byte records, 1234 recorded, 1234 retained,
+            4000000000 cycles in 400 ticks at 100 Hz on 2 CPUs
+     Trace: name 1 main
+     Trace: 0011223344556677000100010100000002000000
+     ...
+     Trace: end
+
+   (the first line is not actually wrapped) with one hex-encoded
+   struct trace_record per line, oldest first.  The cycle and
+   tick counts let the decoder convert time-stamp counter values
+   to wall-clock time.
+
+   With more than one CPU, the records of all CPUs share the ring
+   in the order they were made, each tagged with its CPU.  Each
+   CPU stamps its records with its own time-stamp counter, and
+   the counters of different CPUs need not agree exactly, so the
+   decoder relies on the order of the records rather than on
+   their time stamps to tell which came first. */
+
+/* A thread name, recorded when the thread is created. */
+struct trace_name {
+  tid_t tid;
+  char name[16];
+};
+
+bool trace_enabled;
+
+static size_t trace_pages;            /* Pages for events, 0 if off. */
+static struct trace_record *records;  /* Ring buffer of events. */
+static size_t record_cap;             /* Capacity of RECORDS. */
+static size_t record_head;            /* Next slot to write. */
+static uint64_t record_cnt;           /* Events recorded so far. */
+static struct trace_name *names;      /* Ring buffer of names. */
+static size_t name_cap;               /* Capacity of NAMES. */
+static uint64_t name_cnt;             /* Names recorded so far. */
+static uint64_t start_tsc;            /* TSC when tracing began. */
+static int64_t start_ticks;           /* Timer ticks when tracing began. */
+static struct spinlock trace_lock;    /* Protects the ring buffers. */
+
+static void trace_thread_action(struct thread *, void *aux);
+
+/* Enables tracing into a ring buffer of PAGES pages once
+   trace_init() is called.  Called by the kernel command-line
+   option parser. */
+void trace_configure(size_t pages) {
+  if (pages == 0)
+    PANIC("trace buffer must be at least one page");
+  trace_pages = pages;
+}
+
+/* Allocates the ring buffers and starts tracing, if tracing was
+   enabled by trace_configure().  Must be called after the page
+   allocator and timer are initialized, with interrupts off. */
+void trace_init(void) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (trace_pages == 0)
+    return;
+
+  records = palloc_get_multiple(PAL_ASSERT, trace_pages);
+  record_cap = trace_pages * PGSIZE / sizeof *records;
+  names = palloc_get_page(PAL_ASSERT);
+  name_cap = PGSIZE / sizeof *names;
+
+  /* Threads that already exist were not named by
+     thread_create(). */
+  thread_foreach(trace_thread_action, NULL);
+
+  start_tsc = tsc_read();
+  start_ticks = timer_ticks();
+  trace_enabled = true;
+}
+
+/* Records the name of thread T, so that the dump can show which
+   thread its events are about. */
+void trace_thread(struct thread *t) {
+  enum intr_level old_level;
+
+  if (!trace_enabled)
+    return;
+
+  old_level = intr_disable();
+  spinlock_acquire(&trace_lock);
+  trace_thread_action(t, NULL);
+  spinlock_release(&trace_lock);
+  intr_set_level(old_level);
+}
+
+/* Appends an event to the ring buffer.  Use trace_event()
+   instead of calling this directly.  May be called from an
+   interrupt handler. */
+void trace_record(enum trace_type type, int reason, int priority, tid_t tid,
+                  tid_t other) {
+  enum intr_level old_level;
+  struct trace_record *r;
+
+  old_level = intr_disable();
+  spinlock_acquire(&trace_lock);
+  r = &records[record_head];
+  r->tsc = tsc_read();
+  r->type = type;
+  r->reason = reason;
+  r->cpu = cpu_current()->id;
+  r->priority = priority;
+  r->tid = tid;
+  r->other = other;
+
+  if (++record_head == record_cap)
+    record_head = 0;
+  record_cnt++;
+  spinlock_release(&trace_lock);
+  intr_set_level(old_level);
+}
+
+/* Prints the trace in the format described at the top of this
+   file. */
+void trace_print_stats(void) {
+  enum intr_level old_level;
+  size_t cnt, first, i;
+
+  if (!trace_enabled)
+    return;
+
+  /* Stop tracing, so that printing doesn't trace itself.  Taking
+     the lock waits out any event another CPU is recording. */
+  old_level = intr_disable();
+  spinlock_acquire(&trace_lock);
+  trace_enabled = false;
+  spinlock_release(&trace_lock);
+  intr_set_level(old_level);
+
+  cnt = record_cnt < record_cap ? record_cnt : record_cap;
+  printf("Trace: begin %zu-byte records, %" PRIu64 " recorded, %zu retained, "
+         "%" PRIu64 " cycles in %" PRId64 " ticks at %d Hz on %u CPUs\n",
+         sizeof *records, record_cnt, cnt, tsc_read() - start_tsc,
+         timer_ticks() - start_ticks, TIMER_FREQ, cpu_count());
+
+  for (i = 0; i < name_cnt && i < name_cap; i++)
+    printf("Trace: name %d %s\n", names[i].tid, names[i].name);
+
+  first = record_cnt < record_cap ? 0 : record_head;
+  for (i = 0; i < cnt; i++) {
+    const uint8_t *p = (const uint8_t *)&records[(first + i) % record_cap];
+    size_t j;
+
+    printf("Trace: ");
+    for (j = 0; j < sizeof *records; j++)
+      printf("%02x", p[j]);
+    printf("\n");
+  }
+  printf("Trace: end\n");
+}
+
+/* Records the name of thread T.  Also used as a thread_foreach()
+   callback.  Interrupts must be off. */
+static void trace_thread_action(struct thread *t, void *aux UNUSED) {
+  struct trace_name *n = &names[name_cnt++ % name_cap];
+  n->tid = t->tid;
+  strlcpy(n->name, t->name, sizeof n->name);
+}
@@ -0,0 +1,69 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "threads/thread.h"
+
+/* Scheduler event tracing.
+
+   When enabled with the "-trace" kernel option, scheduling
+   decisions, wakeups and priority donations are recorded with a
+   time-stamp counter value in a ring buffer.  At shutdown the
+   ring is printed in a compact binary form, hex encoded, which
+   utils/pintos-trace turns into a Chrome trace. */
+
+/* Default number of pages devoted to the ring buffer. */
+#define TRACE_DEFAULT_PAGES 16
+
+/* Kinds of event. */
+enum trace_type {
+  TRACE_SWITCH,  /* schedule() chose NEXT to replace TID. */
+  TRACE_UNBLOCK, /* TID made ready by OTHER. */
+  TRACE_DONATE,  /* TID received PRIORITY from OTHER. */
+  TRACE_WAKE     /* TID's timer_sleep() expired. */
+};
+
+/* Why the running thread gave up the CPU, for TRACE_SWITCH. */
+enum trace_reason {
+  TRACE_BLOCK,   /* Blocked. */
+  TRACE_YIELD,   /* Called thread_yield(). */
+  TRACE_PREEMPT, /* Time slice expired or higher priority ready. */
+  TRACE_EXIT     /* Exited. */
+};
+
+/* One event, as stored in the ring and dumped at shutdown.  All
+   fields are little-endian and the structure has no padding, so
+   the dump can be decoded without knowledge of the kernel's
+   compiler. */
+struct trace_record {
+  uint64_t tsc;    /* Time-stamp counter of the recording CPU. */
+  uint8_t type;    /* enum trace_type. */
+  uint8_t reason;  /* enum trace_reason, or donation chain depth. */
+  uint8_t cpu;     /* Id of the CPU that recorded the event. */
+  int8_t priority; /* Priority of the thread the event is about. */
+  int32_t tid;     /* Thread the event is about. */
+  int32_t other;   /* Next thread, waker or donor; 0 if none. */
+};
+
+/* True if tracing is enabled.  Only for use by trace_event(). */
+extern bool trace_enabled;
+
+void trace_configure(size_t pages);
+void trace_init(void);
+void trace_thread(struct thread *);
+void trace_record(enum trace_type, int reason, int priority, tid_t tid,
+                  tid_t other);
+void trace_print_stats(void);
+
+/* Records an event if tracing is enabled.  Costs a single test
+   of a global variable when it is not. */
+static inline void trace_event(enum trace_type type, int reason,
+                               int priority, tid_t tid, tid_t other) {
+  if (trace_enabled)
+    trace_record(type, reason, priority, tid, other);
+}
+
+#endif /* threads/trace.h */
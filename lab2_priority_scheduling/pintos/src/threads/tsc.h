@@ -0,0 +1,17 @@
+#ifndef THREADS_TSC_H
+#define THREADS_TSC_H
+
+#include <stdint.h>
+
+/* Returns the value of the CPU's time-stamp counter, which
+   increments once per clock cycle.  Useful for timing intervals
+   far shorter than a timer tick.  The counter is not calibrated
+   against wall-clock time.  See [IA32-v2b] "RDTSC". */
+static inline uint64_t
+tsc_read(void) {
+    uint64_t tsc;
+    asm volatile ("rdtsc" : "=A" (tsc));
+    return tsc;
+}
+
+#endif /* threads/tsc.h */